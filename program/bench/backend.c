@@ -0,0 +1,217 @@
+// Минимальный upstream для проверки режима обратного прокси (-P).
+// Поток на соединение, keep-alive. Ответ - строка с номером соединения
+// и запроса в нём (видно переиспользование соединений прокси).
+// Параметры query: size=N - тело из N байт, delay_ms=N - задержка ответа,
+// close=1 - ответ без Content-Length с закрытием соединения,
+// drop=1 - закрытие без ответа, если запрос в соединении не первый
+// (как idle timeout upstream'а, совпавший с приходом запроса),
+// interim=1 - перед ответом промежуточные 100 Continue и 103 Early Hints.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define REQUEST_BUF_SIZE 16384
+#define FILL_BUF_SIZE    (64 * 1024)
+
+static int next_conn_id = 0;
+static char fill[FILL_BUF_SIZE];
+
+static int send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Значение параметра query name, -1 - нет
+static long long query_param(const char *path, const char *name) {
+    const char *q = strchr(path, '?');
+    size_t len = strlen(name);
+    while (q) {
+        q++;
+        if (strncmp(q, name, len) == 0 && q[len] == '=') return atoll(q + len + 1);
+        q = strchr(q, '&');
+    }
+    return -1;
+}
+
+// Значение поля заголовка запроса в value (пусто, если нет)
+static void header_value(const char *headers, const char *name, char *value, size_t size) {
+    size_t len = strlen(name);
+    value[0] = '\0';
+    for (const char *line = strstr(headers, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, len) == 0 && line[len] == ':') {
+            const char *v = line + len + 1;
+            while (*v == ' ') v++;
+            size_t n = strcspn(v, "\r\n");
+            if (n >= size) n = size - 1;
+            memcpy(value, v, n);
+            value[n] = '\0';
+            return;
+        }
+    }
+}
+
+static int handle_request(int fd, int conn_id, int req_no, char *headers) {
+    char method[16], path[2048], protocol[16];
+    if (sscanf(headers, "%15s %2047s %15s", method, path, protocol) != 3) return -1;
+
+    char connection[64], xff[64];
+    header_value(headers, "Connection", connection, sizeof(connection));
+    header_value(headers, "X-Forwarded-For", xff, sizeof(xff));
+    int keepalive = strcmp(protocol, "HTTP/1.1") == 0 ? strcasecmp(connection, "close") != 0
+                                                       : strcasecmp(connection, "keep-alive") == 0;
+
+    if (req_no > 1 && query_param(path, "drop") == 1) return -1;
+
+    long long delay_ms = query_param(path, "delay_ms");
+    if (delay_ms > 0) {
+        struct timespec ts = { delay_ms / 1000, (delay_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+
+    char body[4096];
+    long long size = query_param(path, "size");
+    if (size < 0) {
+        size = snprintf(body, sizeof(body), "conn=%d req=%d method=%s path=%s xff=%s\n",
+                        conn_id, req_no, method, path, xff);
+    }
+    int until_close = query_param(path, "close") == 1;
+
+    if (query_param(path, "interim") == 1) {
+        static const char interim[] = "HTTP/1.1 100 Continue\r\n\r\n"
+                                      "HTTP/1.1 103 Early Hints\r\nLink: </style.css>; rel=preload\r\n\r\n";
+        if (send_all(fd, interim, sizeof(interim) - 1) != 0) return -1;
+    }
+
+    char header[256];
+    int len;
+    if (until_close) {
+        len = snprintf(header, sizeof(header),
+                       "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\n");
+        keepalive = 0;
+    } else {
+        len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %lld\r\n"
+                       "Connection: %s\r\n\r\n", size, keepalive ? "keep-alive" : "close");
+    }
+    if (send_all(fd, header, len) != 0) return -1;
+
+    if (strcmp(method, "HEAD") != 0) {
+        if (query_param(path, "size") < 0) {
+            if (send_all(fd, body, size) != 0) return -1;
+        } else {
+            for (long long left = size; left > 0; ) {
+                size_t n = left < FILL_BUF_SIZE ? (size_t)left : FILL_BUF_SIZE;
+                if (send_all(fd, fill, n) != 0) return -1;
+                left -= n;
+            }
+        }
+    }
+    return keepalive ? 0 : -1;
+}
+
+static void *conn_thread(void *arg) {
+    int fd = (int)(long)arg;
+    int conn_id = __sync_add_and_fetch(&next_conn_id, 1);
+    char *buf = malloc(REQUEST_BUF_SIZE);
+    size_t len = 0;
+    if (buf) buf[0] = '\0';
+
+    for (int req_no = 1; buf; ) {
+        char *end = NULL;
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            if (len >= REQUEST_BUF_SIZE - 1) goto out;
+            ssize_t n = recv(fd, buf + len, REQUEST_BUF_SIZE - 1 - len, 0);
+            if (n <= 0) goto out;
+            len += n;
+            buf[len] = '\0';
+        }
+        *end = '\0';
+        if (handle_request(fd, conn_id, req_no++, buf) != 0) break;
+
+        // Запросы без тела: следующий начинается сразу после "\r\n\r\n"
+        size_t used = end + 4 - buf;
+        memmove(buf, buf + used, len - used + 1);
+        len -= used;
+    }
+out:
+    free(buf);
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <port>|unix:<path>\n", argv[0]);
+        return 1;
+    }
+    memset(fill, 'x', sizeof(fill));
+
+    int listen_fd;
+    if (strncmp(argv[1], "unix:", 5) == 0) {
+        struct sockaddr_un addr = {0};
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", argv[1] + 5);
+        unlink(addr.sun_path);
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            perror("bind");
+            return 1;
+        }
+    } else {
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(atoi(argv[1]));
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            perror("bind");
+            return 1;
+        }
+    }
+
+    if (listen(listen_fd, 128) != 0) {
+        perror("listen");
+        return 1;
+    }
+    printf("Backend listening on %s\n", argv[1]);
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            return 1;
+        }
+
+        // Заголовок и тело уходят отдельными send(): без Nagle они не ждут
+        // отложенного ACK прокси
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, conn_thread, (void*)(long)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
@@ -0,0 +1,293 @@
+#include "http.h"
+#include "util.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// === Подсчёт аллокаций ===
+// Замена malloc/calloc/realloc/free поверх glibc: перехватываются и вызовы
+// изнутри libc (realpath, stdio и т.д.), а не только из объектов сервера.
+// __libc_* есть только в glibc; на других libc allocs/op = -1 (не измерялось).
+
+static unsigned long long alloc_count = 0;
+
+#ifdef __GLIBC__
+#define BENCH_HAVE_ALLOC_COUNT 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    alloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    alloc_count++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+#else
+#define BENCH_HAVE_ALLOC_COUNT 0
+#endif
+
+// === Измерение ===
+
+// Результат не должен быть выброшен компилятором
+static volatile long long sink;
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// Циклы опорного счётчика (TSC); 0 - счётчик недоступен на платформе
+static unsigned long long now_cycles(void) {
+#if BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct bench_ctx {
+    const char *docroot;
+    int docroot_fd;
+    const char *input;
+    char buf[PATH_MAX];
+};
+
+typedef void (*bench_fn)(struct bench_ctx *ctx);
+
+struct bench_result {
+    double ns_per_op;
+    double cycles_per_op;
+    double allocs_per_op;
+};
+
+static void run_bench(bench_fn fn, struct bench_ctx *ctx, long iterations, struct bench_result *res) {
+    // Прогрев: кэши, dentry-кэш ядра, ленивые инициализации libc
+    for (long i = 0; i < iterations / 10 + 1; i++) {
+        fn(ctx);
+    }
+
+    unsigned long long allocs_before = alloc_count;
+    unsigned long long t0 = now_ns();
+    unsigned long long c0 = now_cycles();
+    for (long i = 0; i < iterations; i++) {
+        fn(ctx);
+    }
+    unsigned long long c1 = now_cycles();
+    unsigned long long t1 = now_ns();
+    unsigned long long allocs_after = alloc_count;
+
+    res->ns_per_op = (double)(t1 - t0) / iterations;
+    res->cycles_per_op = (double)(c1 - c0) / iterations;
+    res->allocs_per_op = BENCH_HAVE_ALLOC_COUNT ? (double)(allocs_after - allocs_before) / iterations : -1;
+}
+
+// === Тестируемые функции ===
+
+static void bench_parse_request_line(struct bench_ctx *ctx) {
+    struct http_request req;
+    sink += http_parse_request_line(ctx->input, &req);
+}
+
+static void bench_is_path_safe(struct bench_ctx *ctx) {
+    sink += is_path_safe(ctx->docroot, ctx->input, ctx->buf);
+}
+
+static void bench_open_beneath(struct bench_ctx *ctx) {
+    struct stat st;
+    int fd = open_beneath(ctx->docroot_fd, ctx->docroot, ctx->input, &st);
+    if (fd >= 0) {
+        sink += st.st_size;
+        close(fd);
+    }
+}
+
+static void bench_get_content_type(struct bench_ctx *ctx) {
+    sink += (long long)(size_t)get_content_type(ctx->input);
+}
+
+static void bench_format_header(struct bench_ctx *ctx) {
+    sink += http_format_header(ctx->buf, 1024, get_content_type(ctx->input), 10485760LL,
+                               NULL, NULL, 0);
+}
+
+static void bench_log_request(struct bench_ctx *ctx) {
+    log_request("127.0.0.1", 54321, "GET", ctx->input, 200, 10485760);
+}
+
+// === Входные данные ===
+
+struct bench_case {
+    const char *name;
+    bench_fn fn;
+    long iterations;
+    const char *input;
+};
+
+static char long_query_line[2200];
+static char long_query_path[1900];
+
+static void build_long_inputs(void) {
+    // Длинная query-строка, близкая к пределу path[2048]
+    strcpy(long_query_path, "/index.html?");
+    size_t len = strlen(long_query_path);
+    while (len < sizeof(long_query_path) - 16) {
+        len += (size_t)snprintf(long_query_path + len, sizeof(long_query_path) - len, "k%zu=v&", len);
+    }
+    snprintf(long_query_line, sizeof(long_query_line), "GET %s HTTP/1.1", long_query_path);
+}
+
+static const struct bench_case cases[] = {
+    { "http_parse_request_line", bench_parse_request_line, 1000000, "GET / HTTP/1.1" },
+    { "http_parse_request_line", bench_parse_request_line, 1000000, "GET /resources/images/profile.webp HTTP/1.1" },
+    { "http_parse_request_line", bench_parse_request_line, 1000000, "HEAD /css/styles.css HTTP/1.0" },
+    { "http_parse_request_line", bench_parse_request_line, 200000,  long_query_line },
+    { "http_parse_request_line", bench_parse_request_line, 1000000, "POST /index.html HTTP/1.1" },
+
+    { "is_path_safe", bench_is_path_safe, 100000, "/index.html" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/css/styles.css" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/js/visualizer.js" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/resources/images/profile.webp" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/resources/audio/SXLLX_-_MAMA_MA_Slowed_(TheMP3.Info).mp3" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/missing/page.html" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/../../../../etc/passwd" },
+    { "is_path_safe", bench_is_path_safe, 100000, "/css/../js/../../../../../etc/hosts" },
+
+    { "open_beneath", bench_open_beneath, 100000, "/index.html" },
+    { "open_beneath", bench_open_beneath, 100000, "/css/styles.css" },
+    { "open_beneath", bench_open_beneath, 100000, "/resources/images/profile.webp" },
+    { "open_beneath", bench_open_beneath, 100000, "/missing/page.html" },
+    { "open_beneath", bench_open_beneath, 100000, "/../../../../etc/passwd" },
+    { "open_beneath", bench_open_beneath, 100000, "/css/../js/../../../../../etc/hosts" },
+
+    { "get_content_type", bench_get_content_type, 5000000, "/index.html" },
+    { "get_content_type", bench_get_content_type, 5000000, "/css/styles.css" },
+    { "get_content_type", bench_get_content_type, 5000000, "/resources/images/loading.jpeg" },
+    { "get_content_type", bench_get_content_type, 5000000, "/resources/images/profile.webp" },
+    { "get_content_type", bench_get_content_type, 5000000, "/video/clip.mkv" },
+    { "get_content_type", bench_get_content_type, 5000000, "/resources/audio/track.mp3" },
+    { "get_content_type", bench_get_content_type, 5000000, "/LICENSE" },
+
+    { "http_format_header", bench_format_header, 2000000, "/index.html" },
+    { "http_format_header", bench_format_header, 2000000, "/resources/images/profile.webp" },
+
+    { "log_request", bench_log_request, 200000, "/index.html" },
+    { "log_request", bench_log_request, 200000, long_query_path },
+};
+
+// Ввод для CSV: длинные строки сокращаются, кавычки удваиваются
+static void write_csv_input(FILE *f, const char *input) {
+    size_t len = strlen(input);
+    fputc('"', f);
+    if (len > 48) {
+        fprintf(f, "%.40s...(%zu)", input, len);
+    } else {
+        for (const char *p = input; *p; p++) {
+            if (*p == '"') fputc('"', f);
+            fputc(*p, f);
+        }
+    }
+    fputc('"', f);
+}
+
+int main(int argc, char *argv[]) {
+    const char *docroot = "../htdocs";
+    const char *csv_path = "bench/results.csv";
+    const char *commit = "unknown";
+
+    if (argc >= 2) docroot = argv[1];
+    if (argc >= 3) csv_path = argv[2];
+    if (argc >= 4 && argv[3][0] != '\0') commit = argv[3];
+
+    struct stat st;
+    if (stat(docroot, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Usage: %s [docroot] [csv_file] [commit]\n", argv[0]);
+        return 1;
+    }
+
+    int docroot_fd = open(docroot, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (docroot_fd < 0) {
+        perror("open docroot");
+        return 1;
+    }
+
+    if (log_init("/dev/null") != 0) {
+        fprintf(stderr, "Failed to initialize logger\n");
+        return 1;
+    }
+
+    int need_header = stat(csv_path, &st) != 0;
+    FILE *csv = fopen(csv_path, "a");
+    if (!csv) {
+        perror("fopen csv");
+        log_close();
+        return 1;
+    }
+    if (need_header) {
+        fprintf(csv, "commit,timestamp,function,input,iterations,ns_per_op,cycles_per_op,allocs_per_op\n");
+    }
+
+    char time_buf[32];
+    time_t now = time(NULL);
+    struct tm tm_info;
+    gmtime_r(&now, &tm_info);
+    strftime(time_buf, sizeof(time_buf), "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+
+    build_long_inputs();
+
+    printf("%-24s %-44s %10s %12s %10s\n", "function", "input", "ns/op", "cycles/op", "allocs/op");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const struct bench_case *bc = &cases[i];
+        struct bench_ctx ctx = { .docroot = docroot, .docroot_fd = docroot_fd, .input = bc->input };
+        struct bench_result res;
+
+        run_bench(bc->fn, &ctx, bc->iterations, &res);
+
+        printf("%-24s %-44.44s %10.1f %12.1f %10.2f\n",
+               bc->name, bc->input, res.ns_per_op, res.cycles_per_op, res.allocs_per_op);
+
+        fprintf(csv, "%s,%s,%s,", commit, time_buf, bc->name);
+        write_csv_input(csv, bc->input);
+        fprintf(csv, ",%ld,%.1f,%.1f,%.2f\n",
+                bc->iterations, res.ns_per_op, res.cycles_per_op, res.allocs_per_op);
+    }
+
+    fclose(csv);
+    close(docroot_fd);
+    log_close();
+    printf("Results appended to %s\n", csv_path);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Клиент для замера задержки при низкой нагрузке: последовательные запросы
+// с фиксированной частотой, каждый по новому соединению (сервер закрывает
+// соединение после ответа). Результат - перцентили задержки в CSV.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define WARMUP_REQUESTS 50
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// Один запрос: connect -> send -> чтение до EOF. Возврат задержки в нс, 0 - ошибка
+static unsigned long long do_request(const struct sockaddr_in *addr, const char *req, size_t req_len) {
+    char buf[65536];
+    unsigned long long t0 = now_ns();
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) < 0) {
+        close(fd);
+        return 0;
+    }
+    if (send(fd, req, req_len, MSG_NOSIGNAL) != (ssize_t)req_len) {
+        close(fd);
+        return 0;
+    }
+
+    size_t total = 0;
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        total += n;
+    }
+    close(fd);
+
+    if (n < 0 || total == 0) return 0;
+    return now_ns() - t0;
+}
+
+static int cmp_ull(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const unsigned long long *sorted, int count, double p) {
+    int idx = (int)(p * (count - 1) + 0.5);
+    return sorted[idx] / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <mode> <port> <path> <requests> [rate_per_sec] [csv_file]\n", argv[0]);
+        return 1;
+    }
+
+    const char *mode = argv[1];
+    int port = atoi(argv[2]);
+    const char *path = argv[3];
+    int count = atoi(argv[4]);
+    int rate = argc >= 6 ? atoi(argv[5]) : 100;
+    const char *csv_path = argc >= 7 ? argv[6] : "latency.csv";
+
+    if (port <= 0 || port > 65535 || count <= 0 || rate <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char req[2200];
+    int req_len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    if (req_len <= 0 || req_len >= (int)sizeof(req)) {
+        fprintf(stderr, "Path too long\n");
+        return 1;
+    }
+
+    unsigned long long *samples = calloc(count, sizeof(*samples));
+    if (!samples) return 1;
+
+    for (int i = 0; i < WARMUP_REQUESTS; i++) {
+        do_request(&addr, req, req_len);
+    }
+
+    // Запросы на равных интервалах: между ними worker простаивает
+    unsigned long long interval_ns = 1000000000ULL / rate;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    int ok = 0, errors = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned long long lat = do_request(&addr, req, req_len);
+        if (lat > 0) {
+            samples[ok++] = lat;
+        } else {
+            errors++;
+        }
+
+        unsigned long long t = (unsigned long long)next.tv_nsec + interval_ns;
+        next.tv_sec += t / 1000000000ULL;
+        next.tv_nsec = t % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+    }
+
+    if (ok == 0) {
+        fprintf(stderr, "No successful requests\n");
+        free(samples);
+        return 1;
+    }
+
+    qsort(samples, ok, sizeof(*samples), cmp_ull);
+
+    double sum = 0;
+    for (int i = 0; i < ok; i++) sum += samples[i];
+    double mean_us = sum / ok / 1000.0;
+    double p50 = percentile_us(samples, ok, 0.50);
+    double p99 = percentile_us(samples, ok, 0.99);
+    double p999 = percentile_us(samples, ok, 0.999);
+    double max_us = samples[ok - 1] / 1000.0;
+
+    printf("%-10s rate=%d/s requests=%d errors=%d mean=%.1fus p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus\n",
+           mode, rate, ok, errors, mean_us, p50, p99, p999, max_us);
+
+    struct stat st;
+    int need_header = stat(csv_path, &st) != 0;
+    FILE *csv = fopen(csv_path, "a");
+    if (!csv) {
+        perror("fopen csv");
+        free(samples);
+        return 1;
+    }
+    if (need_header) {
+        fprintf(csv, "mode,rate,requests,errors,mean_us,p50_us,p99_us,p999_us,max_us\n");
+    }
+    fprintf(csv, "%s,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+            mode, rate, ok, errors, mean_us, p50, p99, p999, max_us);
+    fclose(csv);
+
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Сравнение задержки стандартного режима и режима busy poll при низкой нагрузке
+
+set -e
+
+if [ "$#" -lt 4 ]; then
+    echo "Использование: $0 <сервер> <клиент> <htdocs> <порт> [потоки] [busy_poll_us] [запросы] [запросов/с] [csv]"
+    exit 1
+fi
+
+SERVER="$1"
+CLIENT="$2"
+HTDOCS="$3"
+PORT="$4"
+THREADS="${5:-1}"
+BUSY_POLL_US="${6:-20000}"
+REQUESTS="${7:-2000}"
+RATE="${8:-100}"
+OUTPUT_FILE="${9:-$(dirname "$CLIENT")/latency.csv}" # рядом с бинарниками, вне исходников
+URL_PATH="/css/styles.css"
+
+cleanup() {
+    if [ -n "${SERVER_PID-}" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=
+    fi
+}
+
+trap cleanup EXIT
+
+wait_for_server() {
+    for i in {1..30}; do
+        if curl -s --max-time 1 "http://localhost:$PORT/" >/dev/null; then
+            return 0
+        fi
+        sleep 0.2
+    done
+    echo "Ошибка: сервер не запустился на порту $PORT"
+    exit 1
+}
+
+run_mode() {
+    local mode="$1"
+    shift
+
+    echo ">>> Режим $mode: $SERVER $* $HTDOCS $PORT $THREADS"
+    "$SERVER" "$@" "$HTDOCS" "$PORT" "$THREADS" > /dev/null &
+    SERVER_PID=$!
+    wait_for_server
+
+    "$CLIENT" "$mode" "$PORT" "$URL_PATH" "$REQUESTS" "$RATE" "$OUTPUT_FILE"
+
+    cleanup
+}
+
+echo "Задержка при $RATE запросах/с, $REQUESTS запросов, файл $URL_PATH"
+
+run_mode standard
+run_mode busy_poll -b "$BUSY_POLL_US"
+
+echo "Результаты дописаны в $OUTPUT_FILE"
@@ -0,0 +1,325 @@
+// Генератор нагрузки для make perf: threads потоков, всего connections
+// одновременных соединений, каждое повторяет запрос (сервер закрывает
+// соединение после ответа) до истечения duration или requests_per_conn.
+// Результат - одна строка CSV со сводкой (заголовок - первой строкой).
+// Ответ не "200" или тело короче/длиннее Content-Length - ошибка, без замера.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define RECV_BUF_SIZE (256 * 1024)
+#define HEAD_BUF_SIZE 4096
+
+enum slot_state {
+    SLOT_IDLE,
+    SLOT_CONNECTING,
+    SLOT_RECEIVING,
+    SLOT_FINISHED
+};
+
+struct slot {
+    int fd;
+    enum slot_state state;
+    unsigned long long start_ns;
+    int requests_done;
+    char head[HEAD_BUF_SIZE];     // заголовок ответа до "\r\n\r\n"
+    size_t head_len;
+    int status;                   // 0 - заголовок ещё не получен
+    long long content_length;     // -1 - не указан
+    long long body_bytes;
+};
+
+struct load_thread {
+    pthread_t thread;
+    int conn_count;
+    unsigned long long *samples;  // задержки, нс
+    size_t sample_count;
+    size_t sample_cap;
+    unsigned long long bytes;
+    int errors;
+};
+
+static struct sockaddr_in server_addr;
+static char request[2200];
+static size_t request_len;
+static unsigned long long deadline_ns;  // 0 - без ограничения по времени
+static int requests_per_conn;           // 0 - без ограничения по числу
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void add_sample(struct load_thread *t, unsigned long long lat) {
+    if (t->sample_count == t->sample_cap) {
+        size_t cap = t->sample_cap ? t->sample_cap * 2 : 4096;
+        unsigned long long *s = realloc(t->samples, cap * sizeof(*s));
+        if (!s) return;
+        t->samples = s;
+        t->sample_cap = cap;
+    }
+    t->samples[t->sample_count++] = lat;
+}
+
+static void slot_close(struct slot *s) {
+    if (s->fd >= 0) close(s->fd);
+    s->fd = -1;
+    s->state = SLOT_IDLE;
+}
+
+// Начать новый запрос, если ещё не исчерпан лимит
+static void slot_start(struct load_thread *t, struct slot *s) {
+    if ((requests_per_conn > 0 && s->requests_done >= requests_per_conn) ||
+        (deadline_ns > 0 && now_ns() >= deadline_ns)) {
+        s->state = SLOT_FINISHED;
+        return;
+    }
+
+    s->start_ns = now_ns();
+    s->head_len = 0;
+    s->status = 0;
+    s->content_length = -1;
+    s->body_bytes = 0;
+    s->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (s->fd < 0) {
+        t->errors++;
+        s->state = SLOT_FINISHED;
+        return;
+    }
+
+    int one = 1;
+    setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(s->fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0 && errno != EINPROGRESS) {
+        t->errors++;
+        s->requests_done++;
+        slot_close(s);
+        return;
+    }
+    s->state = SLOT_CONNECTING;
+}
+
+// Разбор заголовка ответа: код и Content-Length. Возврат 0, -1 - не HTTP
+static int parse_head(struct slot *s) {
+    if (sscanf(s->head, "HTTP/%*d.%*d %d", &s->status) != 1 || s->status <= 0) return -1;
+    for (const char *line = strstr(s->head, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            s->content_length = atoll(line + 15);
+        }
+    }
+    return 0;
+}
+
+// Учёт принятых данных: заголовок копируется в head, остальное - тело.
+// Возврат 0, -1 - ответ не разобран
+static int slot_consume(struct slot *s, const char *data, size_t n) {
+    if (s->status == 0) {
+        size_t take = n < HEAD_BUF_SIZE - 1 - s->head_len ? n : HEAD_BUF_SIZE - 1 - s->head_len;
+        memcpy(s->head + s->head_len, data, take);
+        s->head_len += take;
+        s->head[s->head_len] = '\0';
+
+        char *end = strstr(s->head, "\r\n\r\n");
+        if (!end) return s->head_len < HEAD_BUF_SIZE - 1 ? 0 : -1;
+        end[2] = '\0';
+        if (parse_head(s) != 0) return -1;
+
+        // Начало тела - из data за концом заголовка
+        size_t header_len = end + 4 - s->head;
+        size_t before = s->head_len - take;
+        data += header_len - before;
+        n -= header_len - before;
+    }
+    s->body_bytes += n;
+    return 0;
+}
+
+// Успешный ответ: "200" и тело ровно по Content-Length (если он указан)
+static int slot_response_ok(const struct slot *s) {
+    return s->status == 200 && (s->content_length < 0 || s->body_bytes == s->content_length);
+}
+
+static void *load_thread_main(void *arg) {
+    struct load_thread *t = arg;
+    struct slot *slots = calloc(t->conn_count, sizeof(*slots));
+    struct pollfd *pfds = calloc(t->conn_count, sizeof(*pfds));
+    char *buf = malloc(RECV_BUF_SIZE);
+    if (!slots || !pfds || !buf) {
+        t->errors++;
+        free(slots);
+        free(pfds);
+        free(buf);
+        return NULL;
+    }
+
+    for (int i = 0; i < t->conn_count; i++) {
+        slots[i].fd = -1;
+        slots[i].state = SLOT_IDLE;
+    }
+
+    for (;;) {
+        int active = 0;
+        for (int i = 0; i < t->conn_count; i++) {
+            struct slot *s = &slots[i];
+            if (s->state == SLOT_IDLE) slot_start(t, s);
+
+            pfds[i].fd = -1;
+            pfds[i].events = 0;
+            if (s->state == SLOT_CONNECTING) {
+                pfds[i].fd = s->fd;
+                pfds[i].events = POLLOUT;
+                active++;
+            } else if (s->state == SLOT_RECEIVING) {
+                pfds[i].fd = s->fd;
+                pfds[i].events = POLLIN;
+                active++;
+            }
+        }
+        if (active == 0) break;
+
+        if (poll(pfds, t->conn_count, 1000) <= 0) continue;
+
+        for (int i = 0; i < t->conn_count; i++) {
+            struct slot *s = &slots[i];
+            if (pfds[i].fd < 0 || pfds[i].revents == 0) continue;
+
+            if (s->state == SLOT_CONNECTING) {
+                // Запрос целиком помещается в буфер только что открытого сокета
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0 || send(s->fd, request, request_len, MSG_NOSIGNAL) != (ssize_t)request_len) {
+                    t->errors++;
+                    s->requests_done++;
+                    slot_close(s);
+                    continue;
+                }
+                s->state = SLOT_RECEIVING;
+            } else if (s->state == SLOT_RECEIVING) {
+                ssize_t n;
+                int bad = 0;
+                while ((n = recv(s->fd, buf, RECV_BUF_SIZE, 0)) > 0) {
+                    t->bytes += n;
+                    if (slot_consume(s, buf, n) != 0) bad = 1;
+                }
+                if (n == 0 && !bad && slot_response_ok(s)) {
+                    add_sample(t, now_ns() - s->start_ns);
+                    s->requests_done++;
+                    slot_close(s);
+                } else if (n == 0 || bad || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    t->errors++;
+                    s->requests_done++;
+                    slot_close(s);
+                }
+            }
+        }
+    }
+
+    free(slots);
+    free(pfds);
+    free(buf);
+    return NULL;
+}
+
+static int cmp_ull(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 7) {
+        fprintf(stderr, "Usage: %s <port> <path> <threads> <connections> <duration_s> <requests_per_conn>\n"
+                        "       duration_s = 0 / requests_per_conn = 0 - без ограничения\n", argv[0]);
+        return 1;
+    }
+
+    int port = atoi(argv[1]);
+    const char *path = argv[2];
+    int threads = atoi(argv[3]);
+    int connections = atoi(argv[4]);
+    double duration_s = atof(argv[5]);
+    requests_per_conn = atoi(argv[6]);
+
+    if (port <= 0 || port > 65535 || threads <= 0 || connections < threads ||
+        duration_s < 0 || requests_per_conn < 0 || (duration_s == 0 && requests_per_conn == 0)) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    if (len <= 0 || len >= (int)sizeof(request)) {
+        fprintf(stderr, "Path too long\n");
+        return 1;
+    }
+    request_len = len;
+
+    struct load_thread *ts = calloc(threads, sizeof(*ts));
+    if (!ts) return 1;
+
+    unsigned long long start = now_ns();
+    deadline_ns = duration_s > 0 ? start + (unsigned long long)(duration_s * 1e9) : 0;
+
+    for (int i = 0; i < threads; i++) {
+        ts[i].conn_count = connections / threads + (i < connections % threads ? 1 : 0);
+        if (pthread_create(&ts[i].thread, NULL, load_thread_main, &ts[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    size_t total = 0;
+    unsigned long long bytes = 0;
+    int errors = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ts[i].thread, NULL);
+        total += ts[i].sample_count;
+        bytes += ts[i].bytes;
+        errors += ts[i].errors;
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    unsigned long long *all = malloc((total ? total : 1) * sizeof(*all));
+    if (!all) return 1;
+    size_t k = 0;
+    double sum = 0;
+    for (int i = 0; i < threads; i++) {
+        for (size_t j = 0; j < ts[i].sample_count; j++) {
+            all[k++] = ts[i].samples[j];
+            sum += ts[i].samples[j];
+        }
+        free(ts[i].samples);
+    }
+    qsort(all, total, sizeof(*all), cmp_ull);
+
+    double avg_ms = total ? sum / total / 1e6 : 0;
+    double p50_ms = total ? all[(size_t)(0.50 * (total - 1) + 0.5)] / 1e6 : 0;
+    double p99_ms = total ? all[(size_t)(0.99 * (total - 1) + 0.5)] / 1e6 : 0;
+
+    printf("requests,errors,elapsed_s,requests_per_sec,transfer_mbs,latency_avg_ms,latency_p50_ms,latency_p99_ms\n");
+    printf("%zu,%d,%.3f,%.2f,%.2f,%.3f,%.3f,%.3f\n",
+           total, errors, elapsed, total / elapsed, bytes / 1048576.0 / elapsed,
+           avg_ms, p50_ms, p99_ms);
+
+    free(all);
+    free(ts);
+    return errors > 0 && total == 0 ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+#!/bin/bash
+
+# Регрессионный прогон исследований report/data:
+#   test1 - потоки x соединения (index.html)
+#   test2 - параллельная загрузка файлов по 100 МБ
+#   test3 - зависимость от размера файла (1 соединение)
+# Результаты - <data>/testN/perf.csv, сравнение с <data>/testN/perf_baseline.csv.
+# Ошибки load (не 200, неполное тело) - провал прогона.
+# Каждая точка - медиана PERF_REPEAT прогонов load (по requests_per_sec).
+# PERF_UPDATE_BASELINE=1 - записать текущие результаты как новый baseline.
+# p99 только выводится, провалом считается при PERF_P99_GATE=1: sub-ms p99
+# повторяется лишь на выделенной машине с baseline'ом, снятым на ней же.
+
+set -e
+# Ошибка load не должна теряться в конвейере с tail
+set -o pipefail
+export LC_NUMERIC=C
+
+if [ "$#" -lt 5 ]; then
+    echo "Использование: $0 <сервер> <load> <htdocs> <report/data> <порт>"
+    exit 1
+fi
+
+SERVER="$(realpath "$1")"
+LOAD="$(realpath "$2")"
+HTDOCS="$(realpath "$3")"
+DATA_DIR="$(realpath "$4")"
+PORT="$5"
+
+# Параметры прогона (фиксированы для повторяемости, переопределяются окружением)
+PERF_THREADS="${PERF_THREADS:-1 2 4 8}"
+PERF_CONNECTIONS="${PERF_CONNECTIONS:-10 100 500}"
+PERF_DURATION="${PERF_DURATION:-3}"
+PERF_DOWNLOADS="${PERF_DOWNLOADS:-1 2 4 8}"
+PERF_SIZES="${PERF_SIZES:-10KB:10 100KB:100 1MB:1024 10MB:10240 100MB:102400}"
+PERF_RUNS="${PERF_RUNS:-20}"
+PERF_REPEAT="${PERF_REPEAT:-3}"
+PERF_SERVER_THREADS="${PERF_SERVER_THREADS:-8}"
+# Допуски: доля падения пропускной способности и роста p99
+PERF_TOLERANCE="${PERF_TOLERANCE:-0.20}"
+PERF_P99_TOLERANCE="${PERF_P99_TOLERANCE:-0.50}"
+PERF_P99_GATE="${PERF_P99_GATE:-0}"
+PERF_UPDATE_BASELINE="${PERF_UPDATE_BASELINE:-0}"
+
+COMMIT="$(git -C "$DATA_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+WORK_DIR="$(mktemp -d)"
+FIXTURES="$WORK_DIR/htdocs"
+
+cleanup() {
+    stop_server
+    rm -rf "$WORK_DIR"
+}
+
+trap cleanup EXIT
+
+start_server() {
+    local threads="$1"
+    (cd "$WORK_DIR" && exec "$SERVER" "$FIXTURES" "$PORT" "$threads" > /dev/null) &
+    SERVER_PID=$!
+
+    for i in {1..30}; do
+        if curl -s --max-time 1 -o /dev/null "http://localhost:$PORT/"; then
+            return 0
+        fi
+        sleep 0.2
+    done
+    echo "Ошибка: сервер не запустился на порту $PORT"
+    exit 1
+}
+
+stop_server() {
+    if [ -n "${SERVER_PID-}" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=
+    fi
+}
+
+# Сводка load: медианный по requests_per_sec из PERF_REPEAT прогонов,
+# errors - сумма по всем прогонам
+run_load() {
+    local runs errors
+    runs="$(for i in $(seq "$PERF_REPEAT"); do "$LOAD" "$PORT" "$@" | tail -n 1; done)"
+    errors="$(echo "$runs" | awk -F, '{ e += $2 } END { print e }')"
+    echo "$runs" | sort -t, -k4 -g | sed -n "$(( (PERF_REPEAT + 1) / 2 ))p" |
+        awk -F, -v OFS=, -v e="$errors" '{ $2 = e; print }'
+}
+
+# Поле сводки load по номеру (1 - requests, ..., 8 - latency_p99_ms)
+field() {
+    echo "$1" | cut -d, -f"$2"
+}
+
+FAILED=0
+
+# check_errors <сводка load> <описание>: ошибочные ответы - провал прогона,
+# иначе быстрые 404/500 выглядели бы как ускорение
+check_errors() {
+    local errors
+    errors="$(field "$1" 2)"
+    if [ "$errors" != "0" ]; then
+        echo "  ОШИБКА  $2: $errors ответов с ошибкой"
+        FAILED=1
+    fi
+}
+
+# === Фикстуры: копия htdocs + файлы фиксированного размера ===
+
+echo "Подготовка фикстур в $FIXTURES"
+cp -r "$HTDOCS" "$FIXTURES"
+mkdir -p "$FIXTURES/resources/test" "$FIXTURES/resources/temp_filesize_test"
+head -c $((100 * 1024 * 1024)) /dev/zero > "$FIXTURES/resources/test/dataset.bin"
+for file in $PERF_SIZES; do
+    name="${file%%:*}"
+    size_kb="${file##*:}"
+    head -c $((size_kb * 1024)) /dev/zero > "$FIXTURES/resources/temp_filesize_test/file_$name.bin"
+done
+
+# === test1: потоки сервера и клиента x соединения ===
+
+OUT1="$DATA_DIR/test1/perf.csv"
+echo 'commit,threads,connections,latency_avg_ms,latency_p99_ms,requests_per_sec,transfer_mbs' > "$OUT1"
+for threads in $PERF_THREADS; do
+    start_server "$threads"
+    for conns in $PERF_CONNECTIONS; do
+        echo ">>> test1: $threads потоков, $conns соединений"
+        r="$(run_load /index.html "$threads" "$conns" "$PERF_DURATION" 0)"
+        check_errors "$r" "test1 $threads/$conns"
+        echo "$COMMIT,$threads,$conns,$(field "$r" 6),$(field "$r" 8),$(field "$r" 4),$(field "$r" 5)" >> "$OUT1"
+    done
+    stop_server
+done
+
+# === test2: параллельные загрузки 100 МБ ===
+
+OUT2="$DATA_DIR/test2/perf.csv"
+echo 'commit,connections,aver_transfer_mbs,transfer_mbs,time_s,latency_p99_ms' > "$OUT2"
+start_server "$PERF_SERVER_THREADS"
+for n in $PERF_DOWNLOADS; do
+    echo ">>> test2: $n параллельных загрузок"
+    r="$(run_load /resources/test/dataset.bin "$((n < 8 ? n : 8))" "$n" 0 1)"
+    check_errors "$r" "test2 $n"
+    transfer="$(field "$r" 5)"
+    aver="$(awk -v t="$transfer" -v n="$n" 'BEGIN { printf "%.2f", t / n }')"
+    echo "$COMMIT,$n,$aver,$transfer,$(field "$r" 3),$(field "$r" 8)" >> "$OUT2"
+done
+stop_server
+
+# === test3: размер файла, 1 соединение ===
+
+OUT3="$DATA_DIR/test3/perf.csv"
+echo 'commit,name,size_bytes,avg_time_ms,latency_p99_ms,transfer_mbs' > "$OUT3"
+start_server "$PERF_SERVER_THREADS"
+for file in $PERF_SIZES; do
+    name="${file%%:*}"
+    size_kb="${file##*:}"
+    echo ">>> test3: $name"
+    r="$(run_load "/resources/temp_filesize_test/file_$name.bin" 1 1 0 "$PERF_RUNS")"
+    check_errors "$r" "test3 $name"
+    # Скорость - по фактически принятым байтам, а не по номинальному размеру
+    echo "$COMMIT,$name,$((size_kb * 1024)),$(field "$r" 6),$(field "$r" 8),$(field "$r" 5)" >> "$OUT3"
+done
+stop_server
+
+# === Сравнение с baseline ===
+
+# compare <baseline> <current> <ключи> <больше-лучше> <меньше-лучше>
+compare() {
+    awk -F, -v keys="$3" -v higher="$4" -v lower="$5" \
+        -v tol="$PERF_TOLERANCE" -v p99_tol="$PERF_P99_TOLERANCE" -v p99_gate="$PERF_P99_GATE" '
+    function key(   k, i, n, names) {
+        n = split(keys, names, ":")
+        k = ""
+        for (i = 1; i <= n; i++) k = k "," $(col[names[i]])
+        return k
+    }
+    FNR == 1 {
+        delete col
+        for (i = 1; i <= NF; i++) col[$i] = i
+        next
+    }
+    NR == FNR {
+        k = key()
+        for (c in col) base[k, c] = $(col[c])
+        next
+    }
+    {
+        k = key()
+        nh = split(higher, hs, ":")
+        for (i = 1; i <= nh; i++) {
+            b = base[k, hs[i]]; v = $(col[hs[i]])
+            if (b == "") continue
+            status = (v < b * (1 - tol)) ? "REGRESSION" : "ok"
+            if (status != "ok") failed = 1
+            printf "  %-10s %-24s %-18s baseline %10s current %10s\n", status, substr(k, 2), hs[i], b, v
+        }
+        nl = split(lower, ls, ":")
+        for (i = 1; i <= nl; i++) {
+            b = base[k, ls[i]]; v = $(col[ls[i]])
+            if (b == "") continue
+            status = (v > b * (1 + p99_tol)) ? (p99_gate == "1" ? "REGRESSION" : "slower") : "ok"
+            if (status == "REGRESSION") failed = 1
+            printf "  %-10s %-24s %-18s baseline %10s current %10s\n", status, substr(k, 2), ls[i], b, v
+        }
+    }
+    END { exit failed }' "$1" "$2"
+}
+
+for t in test1 test2 test3; do
+    current="$DATA_DIR/$t/perf.csv"
+    baseline="$DATA_DIR/$t/perf_baseline.csv"
+
+    if [ "$PERF_UPDATE_BASELINE" = "1" ]; then
+        if [ "$FAILED" != "0" ]; then
+            echo "$t: baseline не обновлён - в прогоне есть ошибки"
+            continue
+        fi
+        cp "$current" "$baseline"
+        echo "$t: baseline обновлён ($baseline)"
+        continue
+    fi
+    if [ ! -f "$baseline" ]; then
+        echo "$t: нет baseline ($baseline), сравнение пропущено"
+        continue
+    fi
+
+    echo "$t: сравнение с baseline"
+    case "$t" in
+        test1) compare "$baseline" "$current" "threads:connections" "requests_per_sec:transfer_mbs" "latency_p99_ms" || FAILED=1 ;;
+        test2) compare "$baseline" "$current" "connections" "transfer_mbs" "latency_p99_ms" || FAILED=1 ;;
+        test3) compare "$baseline" "$current" "name" "transfer_mbs" "latency_p99_ms" || FAILED=1 ;;
+    esac
+done
+
+if [ "$FAILED" != "0" ]; then
+    echo "Обнаружена регрессия производительности или ошибки load (допуск: $PERF_TOLERANCE, p99: $PERF_P99_TOLERANCE, PERF_P99_GATE=$PERF_P99_GATE)"
+    exit 1
+fi
+echo "Регрессий не обнаружено"
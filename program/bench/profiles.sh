@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Прогон замера test3 (зависимость от размера файла) для каждого профиля сокетов
+
+set -e
+
+if [ "$#" -lt 4 ]; then
+    echo "Использование: $0 <сервер> <htdocs> <порт> <потоки> [повторы] [csv]"
+    exit 1
+fi
+
+SERVER="$(realpath "$1")"
+HTDOCS="$(realpath "$2")"
+PORT="$3"
+THREADS="$4"
+NUM_RUNS="${5:-5}"
+OUTPUT_FILE="$(realpath -m "${6:-$(dirname "$SERVER")/profiles.csv}")" # вне исходников
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+TEST3="$SCRIPT_DIR/../../report/data/test3/test.sh"
+PROFILES=(none small bulk latency auto)
+
+if [[ ! -f "$OUTPUT_FILE" ]]; then
+    echo 'profile,name,size_bytes,avg_time_ms,avg_throughput_mbs' > "$OUTPUT_FILE"
+fi
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+for profile in "${PROFILES[@]}"; do
+    echo ">>> Профиль $profile"
+    mkdir -p "$WORK_DIR/$profile"
+    (
+        cd "$WORK_DIR/$profile"
+        SERVER_ARGS="-p $profile" "$TEST3" "$SERVER" "$HTDOCS" "$PORT" "$THREADS" "$NUM_RUNS" > /dev/null
+    )
+    tail -n +2 "$WORK_DIR/$profile/results_avg.csv" | sort -t, -k2 -n | sed "s/^/$profile,/" >> "$OUTPUT_FILE"
+done
+
+echo "Результаты дописаны в $OUTPUT_FILE"
@@ -0,0 +1,129 @@
+#!/bin/bash
+
+# Проверка режима обратного прокси на локальном backend'е:
+#   маршруты TCP и UDS, статика рядом с прокси, переиспользование соединений,
+#   splice большого тела, ответ до закрытия соединения, HEAD, "." и ".." в пути,
+#   повтор запроса после закрытия соединения из пула, 1xx перед ответом,
+#   запрос с телом, 502/503, итоговые метрики
+# и замер load: статический файл против проксируемого пути.
+
+set -e
+
+if [ "$#" -lt 5 ]; then
+    echo "Использование: $0 <сервер> <backend> <load> <htdocs> <порт>"
+    exit 1
+fi
+
+SERVER="$(realpath "$1")"
+BACKEND="$(realpath "$2")"
+LOAD="$(realpath "$3")"
+HTDOCS="$(realpath "$4")"
+PORT="$5"
+BACKEND_PORT="$((PORT + 1))"
+PROXY_DURATION="${PROXY_DURATION:-3}"
+
+WORK_DIR="$(mktemp -d)"
+SOCK="$WORK_DIR/backend.sock"
+URL="http://localhost:$PORT"
+FAILED=0
+
+cleanup() {
+    for pid in ${SERVER_PID-} ${BACKEND_PID-} ${UDS_BACKEND_PID-}; do
+        kill "$pid" 2>/dev/null || true
+        wait "$pid" 2>/dev/null || true
+    done
+    rm -rf "$WORK_DIR"
+}
+
+trap cleanup EXIT
+
+# check <описание> <ожидаемая подстрока> <фактическое значение>
+check() {
+    if [[ "$3" == *"$2"* ]]; then
+        echo "  ok    $1"
+    else
+        echo "  FAIL  $1: ожидалось '$2', получено '$3'"
+        FAILED=1
+    fi
+}
+
+"$BACKEND" "$BACKEND_PORT" > /dev/null &
+BACKEND_PID=$!
+"$BACKEND" "unix:$SOCK" > /dev/null &
+UDS_BACKEND_PID=$!
+
+# Один worker: все запросы идут через один пул соединений
+(cd "$WORK_DIR" && exec "$SERVER" -P "/api=127.0.0.1:$BACKEND_PORT" -P "/uds=unix:$SOCK" \
+    "$HTDOCS" "$PORT" 1 > /dev/null) &
+SERVER_PID=$!
+
+for i in {1..30}; do
+    if curl -s --max-time 1 -o /dev/null "$URL/"; then
+        break
+    fi
+    sleep 0.2
+done
+
+echo ">>> Маршрутизация"
+check "статика" "200" "$(curl -s -o /dev/null -w '%{http_code}' "$URL/index.html")"
+check "TCP upstream" "path=/api/hello?x=1 xff=127.0.0.1" "$(curl -s "$URL/api/hello?x=1")"
+check "UDS upstream" "path=/uds/item" "$(curl -s "$URL/uds/item")"
+check "граница префикса" "404" "$(curl -s -o /dev/null -w '%{http_code}' "$URL/apix")"
+check "маршрут по пути без \"..\"" "path=/uds/x" "$(curl -s --path-as-is "$URL/api/../uds/x")"
+check "upstream получает канонический путь" "path=/api/b?q=../c" \
+    "$(curl -s --path-as-is "$URL/api/a/.././b?q=../c")"
+check "выход за корень не проксируется" "404" \
+    "$(curl -s --path-as-is -o /dev/null -w '%{http_code}' "$URL/api/../../x")"
+
+echo ">>> Keep-alive пул"
+first="$(curl -s "$URL/api/a")"
+second="$(curl -s "$URL/api/b")"
+check "то же соединение с upstream'ом" "${first%% req=*}" "$second"
+check "следующий запрос в нём" "req=$(( $(echo "$first" | sed 's/.* req=\([0-9]*\).*/\1/') + 1 ))" "$second"
+
+# Соединение из пула закрывается backend'ом без ответа - повтор на новом
+check "повтор после закрытия соединения из пула" "req=1 method=GET path=/api/c?drop=1" \
+    "$(curl -s "$URL/api/c?drop=1")"
+
+echo ">>> Тело ответа"
+check "10 МБ через splice" "10485760" "$(curl -s -o /dev/null -w '%{size_download}' "$URL/api/big?size=10485760")"
+check "до закрытия соединения" "path=/api/eof?close=1" "$(curl -s "$URL/api/eof?close=1")"
+check "HEAD" "Content-Length: 0" "$(curl -s -I "$URL/api/empty?size=0" | tr -d '\r')"
+check "Connection: close клиенту" "Connection: close" "$(curl -s -I "$URL/api/h" | tr -d '\r')"
+check "1xx пропускается до окончательного ответа" "path=/api/i?interim=1" "$(curl -s "$URL/api/i?interim=1")"
+check "после 1xx соединение в пуле чистое" "path=/api/after" "$(curl -s "$URL/api/after")"
+check "запрос с телом" "400" "$(curl -s -o /dev/null -w '%{http_code}' -X GET --data hello "$URL/api/body")"
+check "запрос с Transfer-Encoding" "400" \
+    "$(curl -s -o /dev/null -w '%{http_code}' -H 'Transfer-Encoding: chunked' "$URL/api/body")"
+check "Content-Length: 0 и Expect не мешают" "path=/api/empty-body" \
+    "$(curl -s -H 'Content-Length: 0' -H 'Expect: 100-continue' "$URL/api/empty-body")"
+
+echo ">>> Замер load (${PROXY_DURATION} с, 1 поток, 10 соединений)"
+echo "  статика: $("$LOAD" "$PORT" /index.html 1 10 "$PROXY_DURATION" 0 | tail -n 1)"
+echo "  прокси:  $("$LOAD" "$PORT" /api/load 1 10 "$PROXY_DURATION" 0 | tail -n 1)"
+echo "  прокси 1 МБ: $("$LOAD" "$PORT" "/api/load?size=1048576" 1 10 "$PROXY_DURATION" 0 | tail -n 1)"
+
+echo ">>> Недоступный upstream"
+kill "$BACKEND_PID" 2>/dev/null || true
+wait "$BACKEND_PID" 2>/dev/null || true
+BACKEND_PID=
+check "ошибка соединения" "502" "$(curl -s -o /dev/null -w '%{http_code}' "$URL/api/down")"
+sleep 3
+check "после проверки здоровья" "503" "$(curl -s -o /dev/null -w '%{http_code}' "$URL/api/down")"
+check "UDS upstream не затронут" "path=/uds/still" "$(curl -s "$URL/uds/still")"
+
+# Итоговые метрики пишутся в лог при остановке
+kill "$SERVER_PID" 2>/dev/null || true
+wait "$SERVER_PID" 2>/dev/null || true
+SERVER_PID=
+echo ">>> События прокси в server.log"
+grep '\[event\] proxy:' "$WORK_DIR/server.log" | sed 's/^/  /' || true
+api_events="$(grep '\[event\] proxy: /api' "$WORK_DIR/server.log" || true)"
+check "повтор учтён в метриках" "retries=1" "$api_events"
+check "метрики при остановке" "down requests=" "$api_events"
+
+if [ "$FAILED" != "0" ]; then
+    echo "Проверка прокси не пройдена"
+    exit 1
+fi
+echo "Проверка прокси пройдена"
@@ -0,0 +1,78 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Формат bundle-файла (порядок байт - хоста, собирается утилитой pack):
+//   bundle_header
+//   uint32_t buckets[bucket_count]      - хэш-индекс: номер записи или BUNDLE_NO_ENTRY
+//   bundle_entry entries[entry_count]
+//   строки (URL-пути, MIME-типы, ETag), завершённые '\0'
+//   данные файлов
+
+#define BUNDLE_MAGIC     "NCWBNDL1"
+#define BUNDLE_VERSION   1
+#define BUNDLE_NO_ENTRY  0xFFFFFFFFu
+
+struct bundle_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t bucket_count;    // степень двойки, открытая адресация
+    uint32_t reserved;
+    uint64_t buckets_offset;
+    uint64_t entries_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+struct bundle_entry {
+    uint64_t hash;            // bundle_hash(path)
+    uint32_t path;            // смещения в таблице строк
+    uint32_t content_type;
+    uint32_t etag;
+    uint32_t gzip_etag;
+    uint64_t offset;          // данные файла (от начала bundle)
+    uint64_t length;
+    uint64_t gzip_offset;     // предсжатый вариант (файл "<path>.gz")
+    uint64_t gzip_length;     // 0 - сжатого варианта нет
+};
+
+// Найденный в bundle файл
+struct bundle_file {
+    const char *content_type;
+    const char *etag;
+    const char *content_encoding; // "gzip" или NULL
+    int has_variants;             // есть сжатый вариант -> нужен Vary
+    long long offset;
+    long long length;
+};
+
+struct bundle;
+
+// FNV-1a от URL-пути
+uint64_t bundle_hash(const char *path);
+
+// Открыть bundle и сделать его текущим. Возврат 0 - успех, -1 - ошибка
+int bundle_init(const char *path);
+
+// Атомарно заменить текущий bundle новым. Ответы, начатые из старого,
+// дорабатывают на своей ссылке; старый закрывается с последней ссылкой
+int bundle_reload(const char *path);
+
+// Закрыть текущий bundle
+void bundle_shutdown(void);
+
+// Взять ссылку на текущий bundle; NULL - сервер работает без bundle
+struct bundle *bundle_acquire(void);
+
+void bundle_release(struct bundle *b);
+
+// Дескриптор файла bundle (для sendfile), закрывать нельзя
+int bundle_fd(const struct bundle *b);
+
+// Поиск нормализованного URL-пути. Возврат 0 - найден, 404 - нет
+int bundle_lookup(const struct bundle *b, const char *path, int accept_gzip, struct bundle_file *out);
+
+#endif // BUNDLE_H
@@ -17,7 +17,29 @@ struct http_request {
 // Возврат 1 при успехе, 0 - ошибка (неподдерживаемый метод, плохой формат)
 int http_parse_request_line(const char *line, struct http_request *req);
 
-int http_prepare_response(const char *docroot, struct http_request *req, char *resolved_path, long long *file_size, const char **content_type);
+// Нормализация пути запроса: отбросить query, "/" и ".../" -> index.html
+// Возврат 0 при успехе, 400 - путь слишком длинный
+int http_normalize_path(struct http_request *req, char *user_path, size_t size);
+
+// Канонический путь для сопоставления с маршрутами: без сегментов "." и ".."
+// (в том числе %2e) и повторных "/", query сохраняется. Результат - в out.
+// Возврат 0 при успехе, 400 - выход выше корня или не помещается в out
+int http_remove_dot_segments(const char *path, char *out, size_t size);
+
+// Согласие клиента на gzip по Accept-Encoding с учётом q-значений: "gzip;q=0"
+// и список только из "identity" - отказ (headers - весь заголовок запроса)
+int http_accepts_gzip(const char *headers);
+
+// Открытие запрошенного файла относительно каталога docroot_fd (см. open_beneath)
+// Возврат 0 при успехе (file_fd, file_size, content_type заполнены), иначе HTTP-код ошибки
+int http_open_file(int docroot_fd, const char *docroot, struct http_request *req,
+                   int *file_fd, long long *file_size, const char **content_type);
+
+// Формирование заголовка "200 OK" в buf размером size
+// etag, content_encoding - NULL, если не нужны; vary - добавить "Vary: Accept-Encoding"
+// Возврат длины заголовка, -1 - не поместился в буфер
+int http_format_header(char *buf, size_t size, const char *content_type, long long content_length,
+                       const char *etag, const char *content_encoding, int vary);
 
 void send_simple_response(int fd, int status_code, const char *status_text);
 
@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 
+struct trace_times;
+
 // Инициализация логгера
 // filename == NULL -> лог в stderr
 int log_init(const char *filename);
@@ -20,4 +22,19 @@ void log_request(
     size_t bytes_sent
 );
 
+// Логирование с длительностями фаз запроса (мкс от accept),
+// недостигнутые фазы выводятся как "-"
+void log_request_trace(
+    const char *client_ip,
+    int client_port,
+    const char *method,
+    const char *path,
+    int status_code,
+    size_t bytes_sent,
+    const struct trace_times *trace
+);
+
+// Служебное событие сервера (масштабирование пула и т.п.), формат printf
+void log_event(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
 #endif // LOG_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <stddef.h>
+
+#include "http.h"
+
+#define PROXY_MAX_ROUTES   8
+#define PROXY_POOL_SIZE    16     // простаивающих соединений на upstream в одном worker'е
+#define PROXY_SPARE_PIPES  4      // pipe'ов для splice в запасе у worker'а
+#define PROXY_BUF_SIZE     16384  // запрос к upstream / заголовок ответа
+
+// Простаивающие keep-alive соединения с upstream'ами и pipe'ы одного worker'а.
+// Принадлежит worker'у, блокировки не нужны
+struct proxy_pool {
+    int idle_fds[PROXY_MAX_ROUTES][PROXY_POOL_SIZE];
+    int idle_count[PROXY_MAX_ROUTES];
+    int spare_pipes[PROXY_SPARE_PIPES][2];
+    int spare_count;
+};
+
+// Проксируемый запрос. К upstream'у уходит HTTP/1.0 + "Connection: keep-alive":
+// ответ без chunked, конец тела - Content-Length или закрытие соединения
+struct proxy_conn {
+    int route;
+    int upstream_fd;
+    int connected;              // соединение установлено (из пула или сразу)
+    int reused;                 // соединение взято из пула
+    int pipe_fd[2];             // splice: upstream -> pipe -> клиент, -1 - ещё нет
+    size_t pipe_bytes;          // данных в pipe
+    char buf[PROXY_BUF_SIZE];   // заголовок ответа upstream'а
+    size_t buf_len;
+    char out[PROXY_BUF_SIZE];   // запрос к upstream, затем заголовок для клиента + начало тела
+    size_t request_len;
+    size_t request_sent;
+    size_t out_len;
+    size_t out_sent;
+    long long body_remaining;   // -1 - до закрытия соединения upstream'ом
+    int upstream_eof;
+    int keepalive;              // upstream допускает повторное использование
+    int complete;               // ответ передан клиенту полностью
+    int status;                 // код ответа upstream
+    long long start_us;
+    long long bytes_to_client;
+};
+
+// Добавить маршрут "prefix=host:port" или "prefix=unix:/path" (до запуска сервера)
+// Возврат 0 при успехе, -1 - ошибка формата или разрешения адреса
+int proxy_add_route(const char *spec);
+
+int proxy_route_count(void);
+
+// "prefix -> upstream" для вывода конфигурации и логов
+const char *proxy_route_name(int route);
+
+// Маршрут для пути запроса (самый длинный префикс) после удаления "." и "..",
+// -1 - отдаётся как статика
+int proxy_match(const char *path);
+
+// Поток проверки здоровья upstream'ов и вывода метрик
+int proxy_start(void);
+void proxy_stop(void);
+
+void proxy_pool_close(struct proxy_pool *pool);
+
+// Начало проксирования: соединение из пула или неблокирующий connect,
+// запрос к upstream из заголовка клиента (headers - request_buf без "\r\n\r\n").
+// Возврат 0 (*out заполнен) или HTTP-код ответа клиенту (400 - запрос с телом, 502, 503)
+int proxy_begin(struct proxy_pool *pool, int route, const struct http_request *req,
+                const char *headers, const char *client_ip, struct proxy_conn **out);
+
+// Шаги state machine worker'а
+enum proxy_step {
+    PROXY_ERROR = -1,  // ошибка upstream'а или клиента
+    PROXY_AGAIN = 0,   // ждать готовности сокета
+    PROXY_DONE = 1,    // шаг завершён
+    PROXY_RETRY = 2    // соединение из пула закрыто upstream'ом, запрос повторяется
+                       // на новом: далее соединение (если !connected) и отправка
+};
+
+enum proxy_step proxy_connect_result(struct proxy_conn *pc);
+enum proxy_step proxy_send_request(struct proxy_conn *pc);
+enum proxy_step proxy_recv_header(struct proxy_conn *pc, int is_head);
+enum proxy_step proxy_send_header(struct proxy_conn *pc, int client_fd);
+enum proxy_step proxy_splice_body(struct proxy_conn *pc, int client_fd, int upstream_ready, int client_ready);
+
+// События, которых ждёт этап передачи тела
+int proxy_want_upstream(const struct proxy_conn *pc);
+int proxy_want_client(const struct proxy_conn *pc);
+
+// Завершение: соединение возвращается в пул, если ответ передан полностью
+// и upstream допускает keep-alive; учёт метрик; pc освобождается
+void proxy_finish(struct proxy_pool *pool, struct proxy_conn *pc);
+
+#endif // PROXY_H
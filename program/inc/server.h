@@ -1,10 +1,22 @@
 #ifndef SERVER_H
 #define SERVER_H
 
-// Запуск сервера на указанном порту
-// docroot - корневая директория для файлов
-// worker_count - количество потоков в пуле
+#include "sockopt.h"
+
+// Параметры сервера
+struct server_config {
+    const char *docroot;   // корневая директория для файлов
+    int port;              // порт для прослушивания
+    int worker_count;      // количество потоков в пуле (начальное для адаптивного)
+    int worker_min;        // адаптивный пул: границы числа потоков,
+    int worker_max;        // worker_max == 0 - пул фиксированного размера
+    int busy_poll_us;      // время активного опроса перед сном в poll(), 0 - выключено
+    const char *bundle_path; // bundle вместо docroot (SIGHUP - перечитать), NULL - выключено
+    enum sock_profile sock_profile; // профиль настройки TCP-сокетов
+};
+
+// Запуск сервера с указанными параметрами
 // Возврат 0 при успехе, -1 -- ошибка
-int server_run(const char *docroot, int port, int worker_count);
+int server_run(const struct server_config *cfg);
 
 #endif // SERVER_H
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef SOCKOPT_H
+#define SOCKOPT_H
+
+// Профили настройки TCP-сокетов
+enum sock_profile {
+    SOCK_PROFILE_NONE,        // без настройки (поведение по умолчанию ядра)
+    SOCK_PROFILE_SMALL,       // мелкие файлы: TCP_NODELAY
+    SOCK_PROFILE_BULK,        // крупные файлы: Nagle включён, буфер отправки - автоподстройка ядра
+    SOCK_PROFILE_LOW_LATENCY, // TCP_NODELAY + TCP_NOTSENT_LOWAT
+    SOCK_PROFILE_AUTO         // SMALL или BULK по размеру ответа
+};
+
+// Разбор имени профиля ("none", "small", "bulk", "latency", "auto")
+// Возврат профиля, -1 - неизвестное имя
+int sock_profile_parse(const char *name);
+
+const char *sock_profile_name(enum sock_profile profile);
+
+// Настройка слушающего сокета (до listen): SO_RCVBUF, TCP_DEFER_ACCEPT, TCP_FASTOPEN.
+// Ошибки setsockopt не фатальны - опции, не поддерживаемые ядром, пропускаются
+void sock_tune_listener(int fd, enum sock_profile profile);
+
+// Настройка клиентского сокета перед отправкой ответа размером body_size
+void sock_tune_connection(int fd, enum sock_profile profile, long long body_size);
+
+#endif // SOCKOPT_H
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <time.h>
+
+// Фазы обработки запроса (индексы в trace_times.ns)
+enum trace_phase {
+    TRACE_ACCEPT,        // accept() в главном потоке
+    TRACE_FIRST_BYTE,    // первый recv() с данными
+    TRACE_HEADERS,       // получен "\r\n\r\n"
+    TRACE_RESOLVED,      // путь разрешён, файл открыт
+    TRACE_SEND_FIRST,    // отправлен первый байт ответа
+    TRACE_SEND_LAST,     // отправлен последний байт ответа
+    TRACE_PHASE_COUNT
+};
+
+// Метки времени фаз (CLOCK_MONOTONIC, нс); 0 - фаза не достигнута
+struct trace_times {
+    unsigned long long ns[TRACE_PHASE_COUNT];
+};
+
+static inline unsigned long long trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// Статические USDT-пробы: без подключённого трассировщика это nop.
+// bpftrace -e 'usdt:./app:netserver:phase { @[arg1] = count(); }'
+// arg0 - fd клиента, arg1 - enum trace_phase
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TRACE_PROBE(fd, ph) DTRACE_PROBE2(netserver, phase, (fd), (ph))
+#endif
+#endif
+
+#ifndef TRACE_PROBE
+#define TRACE_PROBE(fd, ph) ((void)0)
+#endif
+
+// Отметка фазы: метка времени сохраняется только в сборке с TRACE=1,
+// проба срабатывает всегда (если поддерживается)
+#ifdef TRACE_PHASES
+#define TRACE_MARK(times, fd, phase) \
+    do { (times)->ns[(phase)] = trace_now_ns(); TRACE_PROBE((fd), (phase)); } while (0)
+#else
+#define TRACE_MARK(times, fd, phase) \
+    do { (void)(times); TRACE_PROBE((fd), (phase)); } while (0)
+#endif
+
+#endif // TRACE_H
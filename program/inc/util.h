@@ -3,18 +3,20 @@
 
 #include <stddef.h>
 
+struct stat;
+
 // Проверка, что user_path безопасен относительно root_dir.
 // При успехе запись канонического пути в resolved (должен быть >= PATH_MAX).
-// Возврат 1 - безопасно, 0 - нет.
+// Возврат 1 - безопасно, 0 - нет (errno: ошибка realpath, EXDEV - выход за пределы).
 int is_path_safe(const char *root_dir, const char *user_path, char *resolved);
 
+// Открытие user_path на чтение относительно каталога root_fd без выхода за его пределы.
+// openat2(RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS) + fstat; на ядрах без openat2 -
+// is_path_safe(root_dir, ...) + open + fstat.
+// Возврат дескриптора (st заполнен), -1 - ошибка в errno (EXDEV - выход за пределы)
+int open_beneath(int root_fd, const char *root_dir, const char *user_path, struct stat *st);
+
 // Возврат MIME-типа по расширению (без точки), например "text/html"
 const char *get_content_type(const char *path);
 
-// Проверка, является ли путь каталогом
-int is_directory(const char *path);
-
-// Возврат размера файла в байтах, или -1 при ошибке
-long long get_file_size(const char *path);
-
 #endif // UTIL_H
\ No newline at end of file
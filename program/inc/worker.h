@@ -1,13 +1,16 @@
 #ifndef WORKER_H
 #define WORKER_H
 
-// Инициализация пула потоков
-int worker_pool_start(const char *docroot, int thread_count);
+#include "server.h"
+
+// Инициализация пула потоков (cfg->worker_count потоков)
+int worker_pool_start(const struct server_config *cfg);
 
 // Остановка пула (ожидание завершения всех потоков)
 int worker_pool_stop(void);
 
-// Назначить новое соединение одному из worker'ов (round-robin)
+// Назначить новое соединение одному из worker'ов (round-robin, пропуская
+// worker'ов с полной очередью). Возврат 0, -1 - client_fd закрыт
 int worker_assign_connection(int client_fd, const char *ip, int port);
 
 #endif // WORKER_H
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "bundle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct bundle {
+    int fd;
+    const unsigned char *map;
+    size_t size;
+    const struct bundle_header *header;
+    const uint32_t *buckets;
+    const struct bundle_entry *entries;
+    const char *strings;
+    int refs;                 // ссылки соединений + 1 у текущего
+};
+
+static struct bundle *current = NULL;
+static pthread_mutex_t current_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t bundle_hash(const char *path) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char*)path; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void bundle_destroy(struct bundle *b) {
+    munmap((void*)b->map, b->size);
+    close(b->fd);
+    free(b);
+}
+
+// Проверка, что диапазон [offset, offset + len) лежит в файле
+static int range_ok(uint64_t offset, uint64_t len, size_t size) {
+    return offset <= size && len <= size - offset;
+}
+
+// Проверка структуры: все смещения указывают внутрь файла
+static int bundle_validate(const struct bundle *b) {
+    const struct bundle_header *h = b->header;
+
+    if (memcmp(h->magic, BUNDLE_MAGIC, sizeof(h->magic)) != 0) return 0;
+    if (h->version != BUNDLE_VERSION) return 0;
+    if (h->bucket_count == 0 || (h->bucket_count & (h->bucket_count - 1)) != 0) return 0;
+    if (h->bucket_count < h->entry_count) return 0;
+    if (h->entries_offset % sizeof(uint64_t) != 0 || h->buckets_offset % sizeof(uint32_t) != 0) return 0;
+
+    if (!range_ok(h->buckets_offset, (uint64_t)h->bucket_count * sizeof(uint32_t), b->size)) return 0;
+    if (!range_ok(h->entries_offset, (uint64_t)h->entry_count * sizeof(struct bundle_entry), b->size)) return 0;
+    if (!range_ok(h->strings_offset, h->strings_size, b->size)) return 0;
+    if (h->strings_size == 0 || b->map[h->strings_offset + h->strings_size - 1] != '\0') return 0;
+
+    for (uint32_t i = 0; i < h->bucket_count; i++) {
+        if (b->buckets[i] != BUNDLE_NO_ENTRY && b->buckets[i] >= h->entry_count) return 0;
+    }
+
+    for (uint32_t i = 0; i < h->entry_count; i++) {
+        const struct bundle_entry *e = &b->entries[i];
+        if (e->path >= h->strings_size || e->content_type >= h->strings_size ||
+            e->etag >= h->strings_size || e->gzip_etag >= h->strings_size) return 0;
+        if (!range_ok(e->offset, e->length, b->size)) return 0;
+        if (!range_ok(e->gzip_offset, e->gzip_length, b->size)) return 0;
+    }
+    return 1;
+}
+
+static struct bundle *bundle_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror("open bundle");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct bundle_header)) {
+        fprintf(stderr, "Invalid bundle: %s\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap bundle");
+        close(fd);
+        return NULL;
+    }
+
+    struct bundle *b = calloc(1, sizeof(*b));
+    if (!b) {
+        munmap(map, st.st_size);
+        close(fd);
+        return NULL;
+    }
+
+    b->fd = fd;
+    b->map = map;
+    b->size = st.st_size;
+    b->header = map;
+    b->buckets = (const uint32_t*)(b->map + b->header->buckets_offset);
+    b->entries = (const struct bundle_entry*)(b->map + b->header->entries_offset);
+    b->strings = (const char*)(b->map + b->header->strings_offset);
+    b->refs = 1;
+
+    if (!bundle_validate(b)) {
+        fprintf(stderr, "Invalid bundle: %s\n", path);
+        bundle_destroy(b);
+        return NULL;
+    }
+
+    // Индекс и строки читаются на каждом запросе - держать в памяти
+    madvise(map, b->header->strings_offset + b->header->strings_size, MADV_WILLNEED);
+    return b;
+}
+
+int bundle_init(const char *path) {
+    return bundle_reload(path);
+}
+
+int bundle_reload(const char *path) {
+    struct bundle *b = bundle_open(path);
+    if (!b) return -1;
+
+    pthread_mutex_lock(&current_mutex);
+    struct bundle *old = current;
+    current = b;
+    pthread_mutex_unlock(&current_mutex);
+
+    if (old) bundle_release(old);
+
+    printf("Bundle loaded: %s (%u entries)\n", path, b->header->entry_count);
+    return 0;
+}
+
+void bundle_shutdown(void) {
+    pthread_mutex_lock(&current_mutex);
+    struct bundle *old = current;
+    current = NULL;
+    pthread_mutex_unlock(&current_mutex);
+
+    if (old) bundle_release(old);
+}
+
+struct bundle *bundle_acquire(void) {
+    pthread_mutex_lock(&current_mutex);
+    struct bundle *b = current;
+    if (b) __sync_fetch_and_add(&b->refs, 1);
+    pthread_mutex_unlock(&current_mutex);
+    return b;
+}
+
+void bundle_release(struct bundle *b) {
+    if (b && __sync_sub_and_fetch(&b->refs, 1) == 0) {
+        bundle_destroy(b);
+    }
+}
+
+int bundle_fd(const struct bundle *b) {
+    return b->fd;
+}
+
+int bundle_lookup(const struct bundle *b, const char *path, int accept_gzip, struct bundle_file *out) {
+    if (!b || !path || !out) return 404;
+
+    uint64_t hash = bundle_hash(path);
+    uint32_t mask = b->header->bucket_count - 1;
+
+    for (uint32_t i = 0; i <= mask; i++) {
+        uint32_t idx = b->buckets[(hash + i) & mask];
+        if (idx == BUNDLE_NO_ENTRY) break;
+
+        const struct bundle_entry *e = &b->entries[idx];
+        if (e->hash != hash || strcmp(b->strings + e->path, path) != 0) continue;
+
+        out->content_type = b->strings + e->content_type;
+        out->has_variants = e->gzip_length > 0;
+        if (accept_gzip && e->gzip_length > 0) {
+            out->etag = b->strings + e->gzip_etag;
+            out->content_encoding = "gzip";
+            out->offset = (long long)e->gzip_offset;
+            out->length = (long long)e->gzip_length;
+        } else {
+            out->etag = b->strings + e->etag;
+            out->content_encoding = NULL;
+            out->offset = (long long)e->offset;
+            out->length = (long long)e->length;
+        }
+        return 0;
+    }
+    return 404;
+}
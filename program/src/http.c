@@ -40,44 +40,187 @@ int http_parse_request_line(const char *line, struct http_request *req) {
     return 1;
 }
 
-int http_prepare_response(const char *docroot, struct http_request *req, char *resolved_path, long long *file_size, const char **content_type) {
-    if (!docroot || !req || !resolved_path || !file_size || !content_type)
-        return -1;
-
-    char user_path[2048];
+int http_normalize_path(struct http_request *req, char *user_path, size_t size) {
     char *q = strchr(req->path, '?');
     if (q) *q = '\0';
 
-    if (snprintf(user_path, sizeof(user_path), "%s", req->path) >= (int)sizeof(user_path))
+    if (snprintf(user_path, size, "%s", req->path) >= (int)size)
         return 400;
 
     if (user_path[0] == '\0' || strcmp(user_path, "/") == 0) {
+        if (size < sizeof("/index.html"))
+            return 400;
         strcpy(user_path, "/index.html");
     } else if (user_path[strlen(user_path) - 1] == '/') {
-        if (strlen(user_path) + 11 >= sizeof(user_path))
+        if (strlen(user_path) + 11 >= size)
             return 400;
         strcat(user_path, "index.html");
     }
+    return 0;
+}
+
+// Сегмент [s, s + len) - "." (1) или ".." (2), в том числе в виде %2e; иначе 0
+static int dot_segment(const char *s, size_t len) {
+    int dots = 0;
+    for (size_t i = 0; i < len; ) {
+        if (s[i] == '.') {
+            i++;
+        } else if (len - i >= 3 && s[i] == '%' && s[i + 1] == '2' && (s[i + 2] == 'e' || s[i + 2] == 'E')) {
+            i += 3;
+        } else {
+            return 0;
+        }
+        if (++dots > 2) return 0;
+    }
+    return dots;
+}
+
+int http_remove_dot_segments(const char *path, char *out, size_t size) {
+    size_t path_len = strcspn(path, "?");
+    const char *p = path, *end = path + path_len;
+    size_t n = 0;
+    int last_dots = 0;
+
+    while (p < end) {
+        if (*p == '/') {
+            p++;
+            continue;
+        }
+        size_t len = strcspn(p, "/?");
+        last_dots = dot_segment(p, len);
+        if (last_dots == 2) {
+            if (n == 0) return 400; // выше корня
+            while (out[n - 1] != '/') n--;
+            n--;
+        } else if (last_dots == 0) {
+            if (n + 1 + len >= size) return 400;
+            out[n++] = '/';
+            memcpy(out + n, p, len);
+            n += len;
+        }
+        p += len;
+    }
+
+    // Завершающий "/" сохраняется: "/a/" и "/a/." - каталог, "/a" - нет
+    if (n == 0 || last_dots != 0 || (path_len > 0 && path[path_len - 1] == '/')) {
+        if (n + 1 >= size) return 400;
+        out[n++] = '/';
+    }
+    if (snprintf(out + n, size - n, "%s", end) >= (int)(size - n)) return 400;
+    return 0;
+}
+
+// q-значение элемента Accept-Encoding [p, end) после имени кодирования:
+// 0 - "q=0", "q=0.0" и т.п. (отказ), 1 - иначе
+static int coding_q_nonzero(const char *p, const char *end) {
+    while (p < end) {
+        const char *semi = memchr(p, ';', end - p);
+        if (!semi) return 1;
+        p = semi + 1;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (end - p >= 2 && (*p == 'q' || *p == 'Q') && p[1] == '=') {
+            p += 2;
+            if (p >= end || *p != '0') return 1;
+            for (p++; p < end && (*p == '.' || *p == '0'); p++) {}
+            return p < end && *p >= '1' && *p <= '9';
+        }
+    }
+    return 1;
+}
 
-    if (!is_path_safe(docroot, user_path, resolved_path))
-        return 403;
+int http_accepts_gzip(const char *headers) {
+    static const char name[] = "accept-encoding:";
+
+    // Пропуск начальной строки, далее построчно
+    const char *line = strstr(headers, "\r\n");
+    while (line) {
+        line += 2;
+        const char *eol = strstr(line, "\r\n");
+        size_t len = eol ? (size_t)(eol - line) : strlen(line);
+
+        if (len > sizeof(name) - 1 && strncasecmp(line, name, sizeof(name) - 1) == 0) {
+            // Элементы через запятую: "gzip;q=0" - явный отказ, "*" - любое
+            // кодирование, не названное отдельно
+            const char *end = line + len;
+            int gzip = -1, any = 0;
+            for (const char *p = line + sizeof(name) - 1; p < end; ) {
+                const char *comma = memchr(p, ',', end - p);
+                const char *item_end = comma ? comma : end;
+                while (p < item_end && (*p == ' ' || *p == '\t')) p++;
+                size_t n = strcspn(p, ";, \t\r");
+                if (n > (size_t)(item_end - p)) n = item_end - p;
+
+                if ((n == 4 && strncasecmp(p, "gzip", 4) == 0) ||
+                    (n == 6 && strncasecmp(p, "x-gzip", 6) == 0)) {
+                    gzip = coding_q_nonzero(p + n, item_end);
+                } else if (n == 1 && *p == '*') {
+                    any = coding_q_nonzero(p + n, item_end);
+                }
+                p = comma ? comma + 1 : end;
+            }
+            return gzip >= 0 ? gzip : any;
+        }
+        line = eol;
+    }
+    return 0;
+}
+
+int http_open_file(int docroot_fd, const char *docroot, struct http_request *req,
+                   int *file_fd, long long *file_size, const char **content_type) {
+    if (!docroot || !req || !file_fd || !file_size || !content_type)
+        return -1;
 
-    long long sz = get_file_size(resolved_path);
-    if (sz < 0) {
-        if (is_directory(resolved_path))
-            return 403;
-        else
+    char user_path[2048];
+    int err = http_normalize_path(req, user_path, sizeof(user_path));
+    if (err != 0)
+        return err;
+
+    struct stat st;
+    int fd = open_beneath(docroot_fd, docroot, user_path, &st);
+    if (fd < 0) {
+        if (errno == ENOENT || errno == ENOTDIR)
             return 404;
+        return 403; // EXDEV (выход за docroot), ELOOP, EACCES и т.д.
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return 403; // каталоги и спецфайлы не отдаются
     }
 
-    if (sz > 128LL * 1024 * 1024)
+    if (st.st_size > 128LL * 1024 * 1024) {
+        close(fd);
         return 413;
+    }
 
-    *file_size = sz;
-    *content_type = get_content_type(resolved_path);
+    *file_fd = fd;
+    *file_size = (long long)st.st_size;
+    *content_type = get_content_type(user_path);
     return 0; // OK
 }
 
+// Формирование заголовка успешного ответа
+int http_format_header(char *buf, size_t size, const char *content_type, long long content_length,
+                       const char *etag, const char *content_encoding, int vary) {
+    if (!buf || !content_type) return -1;
+
+    int len = snprintf(buf, size,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %lld\r\n"
+        "%s%s%s"
+        "%s%s%s"
+        "%s"
+        "Connection: close\r\n"
+        "\r\n",
+        content_type, content_length,
+        etag ? "ETag: " : "", etag ? etag : "", etag ? "\r\n" : "",
+        content_encoding ? "Content-Encoding: " : "", content_encoding ? content_encoding : "", content_encoding ? "\r\n" : "",
+        vary ? "Vary: Accept-Encoding\r\n" : "");
+    if (len <= 0 || (size_t)len >= size) return -1;
+    return len;
+}
+
 // Отправка простого текстового ответа (ошибки)
 void send_simple_response(int fd, int status_code, const char *status_text) {
     char buf[512];
@@ -1,4 +1,5 @@
 #include "log.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,6 +7,7 @@
 #include <time.h>
 #include <pthread.h>
 #include <errno.h>
+#include <stdarg.h>
 
 static FILE *log_file = NULL;
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -42,13 +44,19 @@ void log_close(void) {
     pthread_mutex_unlock(&log_mutex);
 }
 
-void log_request(
+// Имена фаз в строке лога (TRACE_ACCEPT - точка отсчёта)
+static const char *trace_phase_names[TRACE_PHASE_COUNT] = {
+    "accept", "first_byte", "headers", "resolved", "send_first", "send_last"
+};
+
+static void log_write(
     const char *client_ip,
     int client_port,
     const char *method,
     const char *path,
     int status_code,
-    size_t bytes_sent
+    size_t bytes_sent,
+    const struct trace_times *trace
 ) {
     if (!log_inited || !log_file) return;
 
@@ -59,17 +67,79 @@ void log_request(
     char time_buf[32];
     strftime(time_buf, sizeof(time_buf), "%Y-%m-%dT%H:%M:%SZ", &tm_info);
 
+    // Поля фаз формируются вне мьютекса
+    char trace_buf[256] = "";
+    if (trace && trace->ns[TRACE_ACCEPT] != 0) {
+        size_t off = 0;
+        for (int i = TRACE_ACCEPT + 1; i < TRACE_PHASE_COUNT && off < sizeof(trace_buf); i++) {
+            if (trace->ns[i] >= trace->ns[TRACE_ACCEPT]) {
+                off += snprintf(trace_buf + off, sizeof(trace_buf) - off, " %s=%.1fus",
+                                trace_phase_names[i],
+                                (trace->ns[i] - trace->ns[TRACE_ACCEPT]) / 1000.0);
+            } else {
+                off += snprintf(trace_buf + off, sizeof(trace_buf) - off, " %s=-",
+                                trace_phase_names[i]);
+            }
+        }
+    }
+
     pthread_mutex_lock(&log_mutex);
     fprintf(log_file,
-            "[%s] [%s:%d] \"%s %s\" %d %zu\n",
+            "[%s] [%s:%d] \"%s %s\" %d %zu%s\n",
             time_buf,
             client_ip,
             client_port,
             method,
             path,
             status_code,
-            bytes_sent
+            bytes_sent,
+            trace_buf
     );
     fflush(log_file);
     pthread_mutex_unlock(&log_mutex);
-}
\ No newline at end of file
+}
+
+void log_request(
+    const char *client_ip,
+    int client_port,
+    const char *method,
+    const char *path,
+    int status_code,
+    size_t bytes_sent
+) {
+    log_write(client_ip, client_port, method, path, status_code, bytes_sent, NULL);
+}
+
+void log_request_trace(
+    const char *client_ip,
+    int client_port,
+    const char *method,
+    const char *path,
+    int status_code,
+    size_t bytes_sent,
+    const struct trace_times *trace
+) {
+    log_write(client_ip, client_port, method, path, status_code, bytes_sent, trace);
+}
+
+void log_event(const char *fmt, ...) {
+    if (!log_inited || !log_file) return;
+
+    time_t now = time(NULL);
+    struct tm tm_info;
+    gmtime_r(&now, &tm_info);
+
+    char time_buf[32];
+    strftime(time_buf, sizeof(time_buf), "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+
+    char msg[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    pthread_mutex_lock(&log_mutex);
+    fprintf(log_file, "[%s] [event] %s\n", time_buf, msg);
+    fflush(log_file);
+    pthread_mutex_unlock(&log_mutex);
+}
@@ -1,40 +1,117 @@
 #include "server.h"
 #include "log.h"
+#include "proxy.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-a min:max] [-b busy_poll_us] [-B bundle]\n"
+                    "       [-p none|small|bulk|latency|auto] [-P prefix=host:port|prefix=unix:/path]...\n"
+                    "       [docroot] [port] [worker_threads]\n", prog);
+}
 
 int main(int argc, char *argv[]) {
-    const char *docroot = "./htdocs";
-    int port = 8080;
-    int worker_threads = 8;
+    struct server_config cfg = {
+        .docroot = "./htdocs",
+        .port = 8080,
+        .worker_count = 8,
+        .worker_min = 0,
+        .worker_max = 0,
+        .busy_poll_us = 0,
+        .bundle_path = NULL,
+        .sock_profile = SOCK_PROFILE_NONE,
+    };
+    int profile;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:b:B:p:P:")) != -1) {
+        switch (opt) {
+        case 'a':
+            if (sscanf(optarg, "%d:%d", &cfg.worker_min, &cfg.worker_max) != 2 ||
+                cfg.worker_min <= 0 || cfg.worker_max < cfg.worker_min) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'b':
+            cfg.busy_poll_us = atoi(optarg);
+            break;
+        case 'B':
+            cfg.bundle_path = optarg;
+            break;
+        case 'p':
+            profile = sock_profile_parse(optarg);
+            if (profile < 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            cfg.sock_profile = profile;
+            break;
+        case 'P':
+            if (proxy_add_route(optarg) != 0) {
+                fprintf(stderr, "Invalid proxy route: %s\n", optarg);
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
 
-    if (argc >= 2) {
-        docroot = argv[1];
+    int argn = argc - optind;
+    char **args = argv + optind;
+
+    if (argn >= 1) {
+        cfg.docroot = args[0];
     }
-    if (argc >= 3) {
-        port = atoi(argv[2]);
+    if (argn >= 2) {
+        cfg.port = atoi(args[1]);
     }
-    if (argc >= 4) {
-        worker_threads = atoi(argv[3]);
+    if (argn >= 3) {
+        cfg.worker_count = atoi(args[2]);
     }
 
-    if (port <= 0 || port > 65535 || worker_threads <= 0) {
-        fprintf(stderr, "Usage: %s [docroot] [port] [worker_threads]\n", argv[0]);
+    if (cfg.port <= 0 || cfg.port > 65535 || cfg.worker_count <= 0 || cfg.busy_poll_us < 0) {
+        print_usage(argv[0]);
         return 1;
     }
 
+    // Начальный размер адаптивного пула - в пределах [min, max]
+    if (cfg.worker_max > 0) {
+        if (cfg.worker_count < cfg.worker_min) cfg.worker_count = cfg.worker_min;
+        if (cfg.worker_count > cfg.worker_max) cfg.worker_count = cfg.worker_max;
+    }
+
     printf("Starting server:\n");
-    printf("  Docroot: %s\n", docroot);
-    printf("  Port: %d\n", port);
-    printf("  Workers: %d\n", worker_threads);
+    printf("  Docroot: %s\n", cfg.docroot);
+    printf("  Port: %d\n", cfg.port);
+    printf("  Workers: %d\n", cfg.worker_count);
+    if (cfg.worker_max > 0) {
+        printf("  Adaptive pool: %d..%d workers\n", cfg.worker_min, cfg.worker_max);
+    }
+    if (cfg.busy_poll_us > 0) {
+        printf("  Busy poll: %d us\n", cfg.busy_poll_us);
+    }
+    if (cfg.bundle_path) {
+        printf("  Bundle: %s\n", cfg.bundle_path);
+    }
+    if (cfg.sock_profile != SOCK_PROFILE_NONE) {
+        printf("  Socket profile: %s\n", sock_profile_name(cfg.sock_profile));
+    }
+    for (int i = 0; i < proxy_route_count(); i++) {
+        printf("  Proxy: %s\n", proxy_route_name(i));
+    }
 
     if (log_init("server.log") != 0) {
         fprintf(stderr, "Failed to initialize logger\n");
         return 1;
     }
 
-    int result = server_run(docroot, port, worker_threads);
+    int result = server_run(&cfg);
 
     log_close();
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,721 @@
+// splice(), pipe2(), memmem()
+#define _GNU_SOURCE
+
+#include "proxy.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define PROXY_PIPE_SIZE            65536  // ёмкость pipe по умолчанию
+#define PROXY_HEADER_MAX           (PROXY_BUF_SIZE - 64) // место под "Connection: close"
+#define PROXY_HEALTH_INTERVAL_MS   2000
+#define PROXY_HEALTH_TIMEOUT_MS    1000
+#define PROXY_STATS_INTERVAL_MS    10000
+#define PROXY_FAIL_THRESHOLD       3      // ошибок подряд до пометки upstream'а недоступным
+#define PROXY_HIST_BUCKETS         24     // задержки 2^i мкс, до ~16 с
+
+// Метрики upstream'а, обновляются worker'ами атомарно
+struct upstream_stats {
+    unsigned long requests;
+    unsigned long errors;
+    unsigned long reused;
+    unsigned long retries;             // повторы на новом соединении вместо закрытого из пула
+    unsigned long long header_us_sum;  // до заголовка ответа upstream'а
+    unsigned long long total_us_sum;   // до передачи ответа клиенту
+    unsigned long header_hist[PROXY_HIST_BUCKETS];
+};
+
+struct proxy_route {
+    char prefix[256];
+    size_t prefix_len;
+    char name[512];                 // "prefix -> upstream"
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    volatile int healthy;
+    volatile int fail_streak;       // ошибок подряд в worker'ах
+    struct upstream_stats stats;
+};
+
+// Маршруты заполняются до запуска потоков и далее не меняются
+static struct proxy_route routes[PROXY_MAX_ROUTES];
+static int route_count = 0;
+
+static pthread_t health_thread;
+static int health_running = 0;
+static int health_stop = 0;
+static pthread_mutex_t health_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t health_cond = PTHREAD_COND_INITIALIZER;
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// === Маршруты ===
+
+int proxy_add_route(const char *spec) {
+    if (route_count >= PROXY_MAX_ROUTES) return -1;
+
+    const char *eq = strchr(spec, '=');
+    if (!eq || spec[0] != '/' || (size_t)(eq - spec) >= sizeof(routes[0].prefix)) return -1;
+
+    struct proxy_route *r = &routes[route_count];
+    memset(r, 0, sizeof(*r));
+    memcpy(r->prefix, spec, eq - spec);
+    r->prefix_len = eq - spec;
+
+    const char *target = eq + 1;
+    if (strncmp(target, "unix:", 5) == 0) {
+        struct sockaddr_un *sun = (struct sockaddr_un*)&r->addr;
+        const char *path = target + 5;
+        if (path[0] == '\0' || strlen(path) >= sizeof(sun->sun_path)) return -1;
+        sun->sun_family = AF_UNIX;
+        strcpy(sun->sun_path, path);
+        r->addr_len = sizeof(*sun);
+    } else {
+        // host:port, IPv6 - в квадратных скобках
+        char host[256];
+        const char *colon = strrchr(target, ':');
+        if (!colon || colon == target || (size_t)(colon - target) >= sizeof(host)) return -1;
+        memcpy(host, target, colon - target);
+        host[colon - target] = '\0';
+        if (host[0] == '[' && host[strlen(host) - 1] == ']') {
+            memmove(host, host + 1, strlen(host) - 2);
+            host[strlen(host) - 2] = '\0';
+        }
+
+        struct addrinfo hints = {0}, *res;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, colon + 1, &hints, &res) != 0) return -1;
+        memcpy(&r->addr, res->ai_addr, res->ai_addrlen);
+        r->addr_len = res->ai_addrlen;
+        freeaddrinfo(res);
+    }
+
+    snprintf(r->name, sizeof(r->name), "%.*s -> %s", (int)r->prefix_len, spec, target);
+    r->healthy = 1; // до первой проверки
+    route_count++;
+    return 0;
+}
+
+int proxy_route_count(void) {
+    return route_count;
+}
+
+const char *proxy_route_name(int route) {
+    return routes[route].name;
+}
+
+int proxy_match(const char *raw_path) {
+    // Сопоставление - по каноническому пути: "/api/../secret" - это "/secret"
+    char path[2048];
+    if (http_remove_dot_segments(raw_path, path, sizeof(path)) != 0) return -1;
+
+    int best = -1;
+    for (int i = 0; i < route_count; i++) {
+        const struct proxy_route *r = &routes[i];
+        if (strncmp(path, r->prefix, r->prefix_len) != 0) continue;
+
+        // "/api" совпадает с "/api", "/api/..." и "/api?...", но не с "/apix"
+        char next = path[r->prefix_len];
+        if (r->prefix[r->prefix_len - 1] != '/' && next != '\0' && next != '/' && next != '?') continue;
+
+        if (best < 0 || r->prefix_len > routes[best].prefix_len) best = i;
+    }
+    return best;
+}
+
+// === Соединения с upstream'ом ===
+
+// Неблокирующий connect. Возврат fd (*connected - установлено сразу), -1 - ошибка
+static int upstream_connect(const struct proxy_route *r, int *connected) {
+    int fd = socket(r->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    if (r->addr.ss_family != AF_UNIX) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (connect(fd, (const struct sockaddr*)&r->addr, r->addr_len) == 0) {
+        *connected = 1;
+    } else if (errno == EINPROGRESS) {
+        *connected = 0;
+    } else {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Простаивающее соединение из пула; закрытые upstream'ом отбрасываются
+static int pool_take(struct proxy_pool *pool, int route) {
+    while (pool->idle_count[route] > 0) {
+        int fd = pool->idle_fds[route][--pool->idle_count[route]];
+        char c;
+        ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return fd;
+        close(fd); // FIN, RST или неожиданные данные
+    }
+    return -1;
+}
+
+void proxy_pool_close(struct proxy_pool *pool) {
+    for (int r = 0; r < PROXY_MAX_ROUTES; r++) {
+        for (int i = 0; i < pool->idle_count[r]; i++) close(pool->idle_fds[r][i]);
+        pool->idle_count[r] = 0;
+    }
+    for (int i = 0; i < pool->spare_count; i++) {
+        close(pool->spare_pipes[i][0]);
+        close(pool->spare_pipes[i][1]);
+    }
+    pool->spare_count = 0;
+}
+
+// Ошибка upstream'а в worker'е: после серии подряд - недоступен до следующей проверки
+static void route_failed(struct proxy_route *r) {
+    if (__sync_add_and_fetch(&r->fail_streak, 1) >= PROXY_FAIL_THRESHOLD) {
+        r->healthy = 0;
+    }
+}
+
+// === Запрос к upstream'у ===
+
+// Строка заголовка [line, eol) - поле name
+static int header_is(const char *line, const char *eol, const char *name) {
+    size_t len = strlen(name);
+    return (size_t)(eol - line) > len && line[len] == ':' && strncasecmp(line, name, len) == 0;
+}
+
+// Значение поля [value, eol) содержит token (без учёта регистра)
+static int header_has_token(const char *value, const char *eol, const char *token) {
+    size_t len = strlen(token);
+    for (const char *p = value; p + len <= eol; p++) {
+        if (strncasecmp(p, token, len) == 0) return 1;
+    }
+    return 0;
+}
+
+// Поля, относящиеся к одному соединению, а не к запросу/ответу
+static int header_is_hop_by_hop(const char *line, const char *eol) {
+    return header_is(line, eol, "Connection") || header_is(line, eol, "Keep-Alive") ||
+           header_is(line, eol, "Proxy-Connection") || header_is(line, eol, "TE") ||
+           header_is(line, eol, "Upgrade");
+}
+
+// Поля, задающие тело запроса. Тело upstream'у не передаётся: с ними он ждал бы
+// его или принял бы за тело следующий запрос из пула
+static int header_is_request_body(const char *line, const char *eol) {
+    return header_is(line, eol, "Content-Length") || header_is(line, eol, "Transfer-Encoding") ||
+           header_is(line, eol, "Expect");
+}
+
+// Запрос клиента объявляет тело: Content-Length > 0 или любой Transfer-Encoding
+static int request_has_body(const char *headers) {
+    const char *line = strstr(headers, "\r\n");
+    while (line) {
+        line += 2;
+        const char *eol = strstr(line, "\r\n");
+        const char *end = eol ? eol : line + strlen(line);
+        if (header_is(line, end, "Transfer-Encoding")) return 1;
+        if (header_is(line, end, "Content-Length") && strtoll(line + 15, NULL, 10) != 0) return 1;
+        line = eol;
+    }
+    return 0;
+}
+
+static int append(char *buf, size_t size, size_t *len, const char *data, size_t n) {
+    if (*len + n > size) return -1;
+    memcpy(buf + *len, data, n);
+    *len += n;
+    return 0;
+}
+
+// "METHOD path HTTP/1.0" + поля клиента (кроме hop-by-hop и полей тела) + X-Forwarded-For.
+// Запрос хранится в out до заголовка ответа - на случай повтора
+static int build_request(struct proxy_conn *pc, const struct http_request *req,
+                         const char *headers, const char *client_ip) {
+    // Upstream получает тот же канонический путь, по которому выбран маршрут
+    char path[2048];
+    if (http_remove_dot_segments(req->path, path, sizeof(path)) != 0) return -1;
+
+    int len = snprintf(pc->out, sizeof(pc->out), "%s %s HTTP/1.0\r\n",
+                       req->method == HTTP_METHOD_HEAD ? "HEAD" : "GET", path);
+    if (len <= 0 || len >= (int)sizeof(pc->out)) return -1;
+    pc->request_len = len;
+
+    // Первая строка клиента пропускается
+    const char *line = strstr(headers, "\r\n");
+    while (line) {
+        line += 2;
+        const char *eol = strstr(line, "\r\n");
+        const char *end = eol ? eol : line + strlen(line);
+        if (end > line && !header_is_hop_by_hop(line, end) && !header_is_request_body(line, end)) {
+            if (append(pc->out, sizeof(pc->out), &pc->request_len, line, end - line) != 0 ||
+                append(pc->out, sizeof(pc->out), &pc->request_len, "\r\n", 2) != 0) {
+                return -1;
+            }
+        }
+        line = eol;
+    }
+
+    len = snprintf(pc->out + pc->request_len, sizeof(pc->out) - pc->request_len,
+                   "X-Forwarded-For: %s\r\nConnection: keep-alive\r\n\r\n", client_ip);
+    if (len <= 0 || (size_t)len >= sizeof(pc->out) - pc->request_len) return -1;
+    pc->request_len += len;
+    pc->request_sent = 0;
+    return 0;
+}
+
+int proxy_begin(struct proxy_pool *pool, int route, const struct http_request *req,
+                const char *headers, const char *client_ip, struct proxy_conn **out) {
+    // GET/HEAD с телом не проксируются - ошибка клиента, не upstream'а
+    if (request_has_body(headers)) return 400;
+
+    struct proxy_route *r = &routes[route];
+    if (!r->healthy) {
+        __sync_fetch_and_add(&r->stats.requests, 1);
+        __sync_fetch_and_add(&r->stats.errors, 1);
+        return 503;
+    }
+
+    struct proxy_conn *pc = malloc(sizeof(*pc));
+    if (!pc) return 502;
+
+    pc->route = route;
+    pc->pipe_fd[0] = pc->pipe_fd[1] = -1;
+    pc->pipe_bytes = 0;
+    pc->buf_len = 0;
+    pc->out_len = pc->out_sent = 0;
+    pc->body_remaining = 0;
+    pc->upstream_eof = 0;
+    pc->keepalive = 0;
+    pc->complete = 0;
+    pc->status = 502;
+    pc->start_us = monotonic_us();
+    pc->bytes_to_client = 0;
+
+    if (build_request(pc, req, headers, client_ip) != 0) {
+        free(pc);
+        return 502;
+    }
+
+    pc->upstream_fd = pool_take(pool, route);
+    pc->reused = pc->upstream_fd >= 0;
+    pc->connected = pc->reused;
+    if (!pc->reused) {
+        pc->upstream_fd = upstream_connect(r, &pc->connected);
+        if (pc->upstream_fd < 0) {
+            __sync_fetch_and_add(&r->stats.requests, 1);
+            __sync_fetch_and_add(&r->stats.errors, 1);
+            route_failed(r);
+            free(pc);
+            return 502;
+        }
+    }
+
+    if (pool->spare_count > 0) {
+        pool->spare_count--;
+        pc->pipe_fd[0] = pool->spare_pipes[pool->spare_count][0];
+        pc->pipe_fd[1] = pool->spare_pipes[pool->spare_count][1];
+    }
+
+    *out = pc;
+    return 0;
+}
+
+enum proxy_step proxy_connect_result(struct proxy_conn *pc) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(pc->upstream_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+        return PROXY_ERROR;
+    }
+    pc->connected = 1;
+    return PROXY_DONE;
+}
+
+// Соединение из пула закрыто upstream'ом (idle timeout) раньше, чем пришёл
+// ответ: запрос повторяется один раз на новом соединении. Проксируются
+// только GET и HEAD, повтор безопасен
+static enum proxy_step retry_fresh(struct proxy_conn *pc) {
+    if (!pc->reused || pc->buf_len > 0) return PROXY_ERROR;
+
+    struct proxy_route *r = &routes[pc->route];
+    close(pc->upstream_fd);
+    pc->upstream_fd = upstream_connect(r, &pc->connected);
+    if (pc->upstream_fd < 0) return PROXY_ERROR;
+    pc->reused = 0;
+    pc->request_sent = 0;
+    __sync_fetch_and_add(&r->stats.retries, 1);
+    return PROXY_RETRY;
+}
+
+enum proxy_step proxy_send_request(struct proxy_conn *pc) {
+    while (pc->request_sent < pc->request_len) {
+        ssize_t n = send(pc->upstream_fd, pc->out + pc->request_sent,
+                         pc->request_len - pc->request_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            pc->request_sent += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return PROXY_AGAIN;
+        } else {
+            return retry_fresh(pc);
+        }
+    }
+    return PROXY_DONE;
+}
+
+// === Ответ upstream'а ===
+
+// Разбор заголовка ответа [0, header_len) и заголовок для клиента в out:
+// hop-by-hop поля заменяются на "Connection: close"
+static int rewrite_response_header(struct proxy_conn *pc, size_t header_len, int is_head) {
+    int major, minor, status;
+    if (sscanf(pc->buf, "HTTP/%d.%d %d", &major, &minor, &status) != 3 || status < 100 || status > 999) {
+        return -1;
+    }
+
+    const char *eol = memmem(pc->buf, header_len, "\r\n", 2);
+    if (!eol) return -1;
+    pc->out_len = 0;
+    append(pc->out, sizeof(pc->out), &pc->out_len, pc->buf, eol - pc->buf + 2);
+
+    long long content_length = -1;
+    int conn_close = 0, conn_keepalive = 0, chunked = 0;
+    const char *end = pc->buf + header_len;
+    const char *line = eol + 2;
+    while (line < end) {
+        eol = memmem(line, end - line, "\r\n", 2);
+        if (!eol) eol = end;
+
+        if (header_is(line, eol, "Content-Length")) {
+            content_length = strtoll(line + 15, NULL, 10);
+            if (content_length < 0) return -1;
+        } else if (header_is(line, eol, "Transfer-Encoding")) {
+            chunked = 1;
+        } else if (header_is(line, eol, "Connection")) {
+            conn_close |= header_has_token(line + 11, eol, "close");
+            conn_keepalive |= header_has_token(line + 11, eol, "keep-alive");
+        }
+
+        if (!header_is_hop_by_hop(line, eol)) {
+            append(pc->out, sizeof(pc->out), &pc->out_len, line, eol - line);
+            append(pc->out, sizeof(pc->out), &pc->out_len, "\r\n", 2);
+        }
+        line = eol + 2;
+    }
+    if (append(pc->out, sizeof(pc->out), &pc->out_len, "Connection: close\r\n\r\n", 21) != 0) {
+        return -1;
+    }
+
+    pc->status = status;
+    if (is_head || status < 200 || status == 204 || status == 304) {
+        pc->body_remaining = 0;
+    } else if (chunked || content_length < 0) {
+        pc->body_remaining = -1; // тело - до закрытия соединения
+    } else {
+        pc->body_remaining = content_length;
+    }
+
+    // HTTP/1.1 - keep-alive по умолчанию, HTTP/1.0 - только явно
+    int upstream_keepalive = (major == 1 && minor >= 1) ? !conn_close : conn_keepalive;
+    pc->keepalive = upstream_keepalive && pc->body_remaining >= 0;
+    return 0;
+}
+
+static void hist_add(unsigned long *hist, long long us) {
+    int b = 0;
+    while (b < PROXY_HIST_BUCKETS - 1 && us >= (2LL << b)) b++;
+    __sync_fetch_and_add(&hist[b], 1);
+}
+
+enum proxy_step proxy_recv_header(struct proxy_conn *pc, int is_head) {
+    for (;;) {
+        ssize_t n = recv(pc->upstream_fd, pc->buf + pc->buf_len, PROXY_HEADER_MAX - pc->buf_len, 0);
+        if (n == 0) return retry_fresh(pc); // закрыто до конца заголовка
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? PROXY_AGAIN : retry_fresh(pc);
+        }
+        pc->buf_len += n;
+        pc->buf[pc->buf_len] = '\0';
+
+        char *end;
+        while ((end = memmem(pc->buf, pc->buf_len, "\r\n\r\n", 4))) {
+            size_t header_len = end - pc->buf + 2; // с CRLF последнего поля
+
+            // Промежуточные ответы 1xx (100 Continue, 103 Early Hints) пропускаются
+            // до окончательного, иначе он остался бы непрочитанным в соединении пула.
+            // 101 - смена протокола, не поддерживается
+            int status = 0;
+            sscanf(pc->buf, "HTTP/%*d.%*d %d", &status);
+            if (status == 101) return PROXY_ERROR;
+            if (status >= 100 && status < 200) {
+                size_t used = header_len + 2;
+                memmove(pc->buf, pc->buf + used, pc->buf_len - used + 1);
+                pc->buf_len -= used;
+                continue;
+            }
+
+            if (rewrite_response_header(pc, header_len, is_head) != 0) return PROXY_ERROR;
+
+            struct proxy_route *r = &routes[pc->route];
+            hist_add(r->stats.header_hist, monotonic_us() - pc->start_us);
+            __sync_fetch_and_add(&r->stats.header_us_sum, (unsigned long long)(monotonic_us() - pc->start_us));
+            r->fail_streak = 0;
+
+            // Начало тела, прочитанное вместе с заголовком
+            size_t body = pc->buf_len - (header_len + 2);
+            if (pc->body_remaining >= 0 && (long long)body > pc->body_remaining) {
+                body = pc->body_remaining; // лишние байты - соединение не переиспользуется
+                pc->keepalive = 0;
+            }
+            append(pc->out, sizeof(pc->out), &pc->out_len, end + 4, body);
+            if (pc->body_remaining > 0) pc->body_remaining -= body;
+            return PROXY_DONE;
+        }
+        if (pc->buf_len >= PROXY_HEADER_MAX) return PROXY_ERROR; // заголовок слишком большой
+    }
+}
+
+enum proxy_step proxy_send_header(struct proxy_conn *pc, int client_fd) {
+    while (pc->out_sent < pc->out_len) {
+        ssize_t n = send(client_fd, pc->out + pc->out_sent, pc->out_len - pc->out_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            pc->out_sent += n;
+            pc->bytes_to_client += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return PROXY_AGAIN;
+        } else {
+            return PROXY_ERROR;
+        }
+    }
+    if (pc->body_remaining == 0) pc->complete = 1;
+    return PROXY_DONE;
+}
+
+// === Тело ответа: splice upstream -> pipe -> клиент, без копирования в user space ===
+
+int proxy_want_upstream(const struct proxy_conn *pc) {
+    return !pc->upstream_eof && pc->body_remaining != 0 && pc->pipe_bytes < PROXY_PIPE_SIZE;
+}
+
+int proxy_want_client(const struct proxy_conn *pc) {
+    return pc->pipe_bytes > 0;
+}
+
+enum proxy_step proxy_splice_body(struct proxy_conn *pc, int client_fd, int upstream_ready, int client_ready) {
+    if (pc->pipe_fd[0] < 0 && pipe2(pc->pipe_fd, O_NONBLOCK | O_CLOEXEC) != 0) {
+        pc->pipe_fd[0] = pc->pipe_fd[1] = -1;
+        return PROXY_ERROR;
+    }
+
+    if (upstream_ready && proxy_want_upstream(pc)) {
+        size_t len = PROXY_PIPE_SIZE - pc->pipe_bytes;
+        if (pc->body_remaining > 0 && (long long)len > pc->body_remaining) len = pc->body_remaining;
+
+        ssize_t n = splice(pc->upstream_fd, NULL, pc->pipe_fd[1], NULL, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            pc->pipe_bytes += n;
+            if (pc->body_remaining > 0) pc->body_remaining -= n;
+            client_ready = 1; // сокет клиента обычно готов - без лишнего круга poll()
+        } else if (n == 0) {
+            pc->upstream_eof = 1;
+            if (pc->body_remaining > 0) return PROXY_ERROR; // тело оборвано
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return PROXY_ERROR;
+        }
+    }
+
+    if (client_ready && pc->pipe_bytes > 0) {
+        ssize_t n = splice(pc->pipe_fd[0], NULL, client_fd, NULL, pc->pipe_bytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            pc->pipe_bytes -= n;
+            pc->bytes_to_client += n;
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            return PROXY_ERROR;
+        }
+    }
+
+    if (pc->pipe_bytes == 0 && (pc->body_remaining == 0 || pc->upstream_eof)) {
+        pc->complete = 1;
+        return PROXY_DONE;
+    }
+    return PROXY_AGAIN;
+}
+
+void proxy_finish(struct proxy_pool *pool, struct proxy_conn *pc) {
+    struct proxy_route *r = &routes[pc->route];
+
+    __sync_fetch_and_add(&r->stats.requests, 1);
+    __sync_fetch_and_add(&r->stats.total_us_sum, (unsigned long long)(monotonic_us() - pc->start_us));
+    if (pc->reused) __sync_fetch_and_add(&r->stats.reused, 1);
+    if (!pc->complete) {
+        __sync_fetch_and_add(&r->stats.errors, 1);
+        // Обрыв со стороны клиента - не повод считать upstream недоступным
+        if (pc->out_len == 0) route_failed(r);
+    }
+
+    if (pc->complete && pc->keepalive && !pc->upstream_eof &&
+        pool->idle_count[pc->route] < PROXY_POOL_SIZE) {
+        pool->idle_fds[pc->route][pool->idle_count[pc->route]++] = pc->upstream_fd;
+    } else if (pc->upstream_fd >= 0) {
+        close(pc->upstream_fd);
+    }
+
+    // Пустой pipe пригоден для следующего ответа
+    if (pc->pipe_fd[0] >= 0) {
+        if (pc->pipe_bytes == 0 && pool->spare_count < PROXY_SPARE_PIPES) {
+            pool->spare_pipes[pool->spare_count][0] = pc->pipe_fd[0];
+            pool->spare_pipes[pool->spare_count][1] = pc->pipe_fd[1];
+            pool->spare_count++;
+        } else {
+            close(pc->pipe_fd[0]);
+            close(pc->pipe_fd[1]);
+        }
+    }
+    free(pc);
+}
+
+// === Проверка здоровья и метрики ===
+
+// Активная проверка: установка соединения за PROXY_HEALTH_TIMEOUT_MS
+static int route_probe(const struct proxy_route *r) {
+    int connected;
+    int fd = upstream_connect(r, &connected);
+    if (fd < 0) return 0;
+
+    if (!connected) {
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        int err = 0;
+        socklen_t len = sizeof(err);
+        connected = poll(&pfd, 1, PROXY_HEALTH_TIMEOUT_MS) == 1 &&
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+    }
+    close(fd);
+    return connected;
+}
+
+// Оценка перцентиля по гистограмме: верхняя граница корзины, мс
+static double hist_percentile_ms(const unsigned long *hist, unsigned long total, double p) {
+    unsigned long need = (unsigned long)(p * total + 0.5), sum = 0;
+    for (int b = 0; b < PROXY_HIST_BUCKETS; b++) {
+        sum += hist[b];
+        if (sum >= need) return (double)(2LL << b) / 1000.0;
+    }
+    return (double)(2LL << (PROXY_HIST_BUCKETS - 1)) / 1000.0;
+}
+
+// Метрики upstream'а за интервал с прошлого вывода (last - снимок)
+static void route_log_stats(struct proxy_route *r, struct upstream_stats *last) {
+    struct upstream_stats now;
+    now.requests = __sync_fetch_and_add(&r->stats.requests, 0);
+    if (now.requests == last->requests) return;
+    now.errors = __sync_fetch_and_add(&r->stats.errors, 0);
+    now.reused = __sync_fetch_and_add(&r->stats.reused, 0);
+    now.retries = __sync_fetch_and_add(&r->stats.retries, 0);
+    now.header_us_sum = __sync_fetch_and_add(&r->stats.header_us_sum, 0);
+    now.total_us_sum = __sync_fetch_and_add(&r->stats.total_us_sum, 0);
+
+    unsigned long hist[PROXY_HIST_BUCKETS], answered = 0;
+    for (int b = 0; b < PROXY_HIST_BUCKETS; b++) {
+        now.header_hist[b] = __sync_fetch_and_add(&r->stats.header_hist[b], 0);
+        hist[b] = now.header_hist[b] - last->header_hist[b];
+        answered += hist[b];
+    }
+
+    unsigned long requests = now.requests - last->requests;
+    log_event("proxy: %s %s requests=%lu errors=%lu reused=%lu retries=%lu avg_ms=%.3f upstream_avg_ms=%.3f upstream_p50_ms<=%.3f upstream_p99_ms<=%.3f",
+              r->name, r->healthy ? "up" : "down", requests,
+              now.errors - last->errors, now.reused - last->reused,
+              now.retries - last->retries,
+              (double)(now.total_us_sum - last->total_us_sum) / requests / 1000.0,
+              answered ? (double)(now.header_us_sum - last->header_us_sum) / answered / 1000.0 : 0.0,
+              answered ? hist_percentile_ms(hist, answered, 0.50) : 0.0,
+              answered ? hist_percentile_ms(hist, answered, 0.99) : 0.0);
+    *last = now;
+}
+
+static void *proxy_health_thread(void *arg) {
+    (void)arg;
+    static struct upstream_stats last[PROXY_MAX_ROUTES];
+    int reported[PROXY_MAX_ROUTES];
+    for (int i = 0; i < route_count; i++) reported[i] = -1;
+    long long last_stats_us = monotonic_us();
+
+    pthread_mutex_lock(&health_mutex);
+    while (!health_stop) {
+        pthread_mutex_unlock(&health_mutex);
+
+        for (int i = 0; i < route_count; i++) {
+            struct proxy_route *r = &routes[i];
+            int up = route_probe(r);
+            if (up) r->fail_streak = 0;
+            r->healthy = up;
+            if (up != reported[i]) {
+                log_event("proxy: upstream %s is %s", r->name, up ? "up" : "down");
+                reported[i] = up;
+            }
+        }
+
+        long long now_us = monotonic_us();
+        if (now_us - last_stats_us >= PROXY_STATS_INTERVAL_MS * 1000LL) {
+            for (int i = 0; i < route_count; i++) route_log_stats(&routes[i], &last[i]);
+            last_stats_us = now_us;
+        }
+
+        pthread_mutex_lock(&health_mutex);
+        if (health_stop) break;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += PROXY_HEALTH_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (PROXY_HEALTH_INTERVAL_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&health_cond, &health_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&health_mutex);
+
+    // Итог за последний неполный интервал
+    for (int i = 0; i < route_count; i++) route_log_stats(&routes[i], &last[i]);
+    return NULL;
+}
+
+int proxy_start(void) {
+    if (route_count == 0 || health_running) return 0;
+
+    health_stop = 0;
+    if (pthread_create(&health_thread, NULL, proxy_health_thread, NULL) != 0) return -1;
+    health_running = 1;
+    return 0;
+}
+
+void proxy_stop(void) {
+    if (!health_running) return;
+
+    pthread_mutex_lock(&health_mutex);
+    health_stop = 1;
+    pthread_cond_signal(&health_cond);
+    pthread_mutex_unlock(&health_mutex);
+
+    pthread_join(health_thread, NULL);
+    health_running = 0;
+}
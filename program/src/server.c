@@ -1,5 +1,7 @@
 #include "server.h"
 #include "worker.h"
+#include "bundle.h"
+#include "proxy.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,20 +12,58 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <signal.h>
+#include <pthread.h>
 
 // Обработчик SIGPIPE - игнорировать (чтобы не падать при разрыве соединения)
 static void sigpipe_handler(int sig) {
     (void)sig;
 }
 
-int server_run(const char *docroot, int port, int worker_count) {
-    if (!docroot || port <= 0 || worker_count <= 0) {
+static volatile sig_atomic_t reload_requested = 0;
+
+// Обработчик SIGHUP - перечитать bundle в главном цикле
+static void sighup_handler(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+// Обработчик SIGTERM/SIGINT - выйти из главного цикла с остановкой pool'а
+// и выводом итоговых метрик
+static void sigterm_handler(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+int server_run(const struct server_config *cfg) {
+    if (!cfg || !cfg->docroot || cfg->port <= 0 || cfg->worker_count <= 0) {
         return -1;
     }
 
     // Игнорировать SIGPIPE - send() будет возвращать -1 вместо срабатывания сигнала
     signal(SIGPIPE, sigpipe_handler);
 
+    // Без SA_RESTART: SIGTERM/SIGINT прерывают accept() с EINTR
+    struct sigaction stop_sa = {0};
+    stop_sa.sa_handler = sigterm_handler;
+    sigemptyset(&stop_sa.sa_mask);
+    sigaction(SIGTERM, &stop_sa, NULL);
+    sigaction(SIGINT, &stop_sa, NULL);
+
+    if (cfg->bundle_path) {
+        if (bundle_init(cfg->bundle_path) != 0) {
+            fprintf(stderr, "Failed to load bundle %s\n", cfg->bundle_path);
+            return -1;
+        }
+
+        // Без SA_RESTART: SIGHUP прерывает accept() с EINTR
+        struct sigaction sa = {0};
+        sa.sa_handler = sighup_handler;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGHUP, &sa, NULL);
+    }
+
     // Создание сокета
     int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (listen_fd < 0) {
@@ -39,11 +79,13 @@ int server_run(const char *docroot, int port, int worker_count) {
         return -1;
     }
 
+    sock_tune_listener(listen_fd, cfg->sock_profile);
+
     // Привязка
     struct sockaddr_in serv_addr = {0};
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serv_addr.sin_port = htons(port);
+    serv_addr.sin_port = htons(cfg->port);
 
     if (bind(listen_fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
         perror("bind");
@@ -57,12 +99,27 @@ int server_run(const char *docroot, int port, int worker_count) {
         return -1;
     }
 
-    printf("Server listening on port %d...\n", port);
+    printf("Server listening on port %d...\n", cfg->port);
+
+    // Запуск worker pool. SIGHUP, SIGTERM и SIGINT блокируются в worker'ах
+    // (маска наследуется), чтобы сигнал доставлялся главному потоку в accept()
+    sigset_t main_signals, old_set;
+    sigemptyset(&main_signals);
+    sigaddset(&main_signals, SIGHUP);
+    sigaddset(&main_signals, SIGTERM);
+    sigaddset(&main_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &main_signals, &old_set);
+    int pool_result = worker_pool_start(cfg);
+    if (pool_result == 0 && proxy_start() != 0) {
+        worker_pool_stop();
+        pool_result = -1;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
 
-    // Запуск worker pool
-    if (worker_pool_start(docroot, worker_count) != 0) {
+    if (pool_result != 0) {
         fprintf(stderr, "Failed to start worker pool\n");
         close(listen_fd);
+        bundle_shutdown();
         return -1;
     }
 
@@ -70,10 +127,19 @@ int server_run(const char *docroot, int port, int worker_count) {
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
 
-    while (1) {
+    while (!stop_requested) {
         int client_fd = accept(listen_fd, (struct sockaddr*)&client_addr, &client_len);
         if (client_fd < 0) {
-            if (errno == EINTR) continue;
+            if (errno == EINTR) {
+                if (stop_requested) break;
+                if (reload_requested) {
+                    reload_requested = 0;
+                    if (bundle_reload(cfg->bundle_path) != 0) {
+                        fprintf(stderr, "Bundle reload failed, keeping the current one\n");
+                    }
+                }
+                continue;
+            }
             perror("accept");
             break;
         }
@@ -83,14 +149,13 @@ int server_run(const char *docroot, int port, int worker_count) {
         inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
         int client_port = ntohs(client_addr.sin_port);
 
-        // Передать соединение worker'у
-        if (worker_assign_connection(client_fd, client_ip, client_port) != 0) {
-            // Если не удалось - закрыть
-            close(client_fd);
-        }
+        // Передать соединение worker'у (при неудаче оно уже закрыто)
+        worker_assign_connection(client_fd, client_ip, client_port);
     }
 
     close(listen_fd);
     worker_pool_stop();
+    proxy_stop();
+    bundle_shutdown();
     return 0;
 }
\ No newline at end of file
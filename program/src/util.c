@@ -6,6 +6,16 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#include <sys/syscall.h>
+#define HAVE_OPENAT2 1
+#endif
+#endif
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -21,9 +31,26 @@ int is_path_safe(const char *root_dir, const char *user_path, char *resolved) {
         user_path++;
     }
 
+    // ".." выше корня - выход за пределы, даже если цели нет (как EXDEV у openat2)
+    int depth = 0;
+    for (const char *seg = user_path; *seg; ) {
+        size_t len = strcspn(seg, "/");
+        if (len == 2 && seg[0] == '.' && seg[1] == '.') {
+            if (--depth < 0) {
+                errno = EXDEV;
+                return 0;
+            }
+        } else if (len > 0 && !(len == 1 && seg[0] == '.')) {
+            depth++;
+        }
+        seg += len;
+        while (*seg == '/') seg++;
+    }
+
     // Сборка полного пути: root_dir + "/" + user_path
     char full_path[PATH_MAX];
     if (snprintf(full_path, sizeof(full_path), "%s/%s", root_dir, user_path) >= (int)sizeof(full_path)) {
+        errno = ENAMETOOLONG;
         return 0; // путь слишком длинный
     }
 
@@ -41,6 +68,7 @@ int is_path_safe(const char *root_dir, const char *user_path, char *resolved) {
     // Проверка: resolved начинается с root_real + '/'
     size_t root_len = strlen(root_real);
     if (strncmp(resolved, root_real, root_len) != 0) {
+        errno = EXDEV;
         return 0;
     }
 
@@ -54,9 +82,69 @@ int is_path_safe(const char *root_dir, const char *user_path, char *resolved) {
         return 1;
     }
 
+    errno = EXDEV;
     return 0;
 }
 
+// Разрешение пути через realpath (ядра без openat2)
+static int open_beneath_fallback(const char *root_dir, const char *user_path, struct stat *st) {
+    char resolved[PATH_MAX];
+    if (!is_path_safe(root_dir, user_path, resolved)) {
+        return -1; // errno - как у openat2: ENOENT/ENOTDIR от realpath, EXDEV - выход за пределы
+    }
+
+    int fd = open(resolved, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    if (fstat(fd, st) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int open_beneath(int root_fd, const char *root_dir, const char *user_path, struct stat *st) {
+    if (!root_dir || !user_path || !st) {
+        errno = EINVAL;
+        return -1;
+    }
+
+#ifdef HAVE_OPENAT2
+    static volatile int openat2_unavailable = 0;
+
+    if (!openat2_unavailable) {
+        // RESOLVE_BENEATH отвергает абсолютные пути - путь берётся от корня
+        while (*user_path == '/') user_path++;
+        if (*user_path == '\0') user_path = ".";
+
+        struct open_how how = {0};
+        how.flags = O_RDONLY | O_CLOEXEC;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+        int fd = (int)syscall(SYS_openat2, root_fd, user_path, &how, sizeof(how));
+        if (fd >= 0) {
+            if (fstat(fd, st) != 0) {
+                int saved = errno;
+                close(fd);
+                errno = saved;
+                return -1;
+            }
+            return fd;
+        }
+
+        // ENOSYS - ядро < 5.6, EPERM - openat2 запрещён seccomp-фильтром контейнера
+        if (errno != ENOSYS && errno != EPERM) return -1;
+        openat2_unavailable = 1;
+    }
+#else
+    (void)root_fd;
+#endif
+
+    return open_beneath_fallback(root_dir, user_path, st);
+}
+
 // MIME-типы (упрощённо)
 const char *get_content_type(const char *path) {
     const char *dot = strrchr(path, '.');
@@ -91,18 +179,3 @@ const char *get_content_type(const char *path) {
 
     return "application/octet-stream";
 }
-
-// Проверка, является ли путь каталогом
-int is_directory(const char *path) {
-    struct stat st;
-    if (stat(path, &st) != 0) return 0;
-    return S_ISDIR(st.st_mode);
-}
-
-// Размер файла
-long long get_file_size(const char *path) {
-    struct stat st;
-    if (stat(path, &st) != 0) return -1;
-    if (S_ISDIR(st.st_mode)) return -1; // каталоги не отдаются
-    return (long long)st.st_size;
-}
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "worker.h"
 #include "http.h"
 #include "log.h"
+#include "trace.h"
+#include "bundle.h"
+#include "proxy.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,21 +14,37 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/sendfile.h>
+#include <time.h>
+#include <sched.h>
 
 #define MAX_CONNECTIONS_PER_WORKER 1024
 #define READ_BUF_SIZE 4096
 
+// Адаптивный пул: период оценки нагрузки и пороги масштабирования
+#define POOL_SCALE_INTERVAL_MS  1000
+#define POOL_SCALE_UP_UTIL      0.75  // доля времени worker'а вне poll()
+#define POOL_SCALE_UP_CONNS     64    // соединений на worker
+#define POOL_SCALE_DOWN_UTIL    0.25
+#define POOL_SCALE_DOWN_CONNS   4
+#define POOL_SCALE_DOWN_STREAK  5     // интервалов низкой нагрузки подряд
+
 // Сообщение для передачи нового соединения
 struct conn_msg {
     int fd;
     char ip[46];
     int port;
+    unsigned long long accept_ns; // момент accept() (только TRACE=1)
 };
 
 enum conn_state {
     CONN_READING,
     CONN_SENDING_HEADER,
     CONN_SENDING_BODY,
+    CONN_PROXY_CONNECTING,    // соединение с upstream'ом
+    CONN_PROXY_SENDING,       // отправка запроса upstream'у
+    CONN_PROXY_WAITING,       // ожидание заголовка ответа
+    CONN_PROXY_HEADER,        // отправка заголовка клиенту
+    CONN_PROXY_BODY,          // splice тела upstream -> клиент
     CONN_DONE
 };
 
@@ -43,24 +62,56 @@ struct connection {
     size_t header_len;
     long long file_size;      // размер файла
     int file_fd;              // открытый файловый дескриптор
+    long long file_offset;    // начало тела в file_fd
+    struct bundle *bundle;    // bundle, из которого отдаётся ответ (file_fd - его)
+    struct proxy_conn *proxy; // проксируемый запрос, NULL - статика
     size_t header_bytes_sent; // сколько байт заголовка уже отправлено
     size_t body_bytes_sent;   // сколько байт тела отправлено
+    struct trace_times trace; // метки фаз запроса
 };
 
 // Данные одного worker-потока
 struct worker {
     pthread_t thread;
+    int id;
     struct connection conns[MAX_CONNECTIONS_PER_WORKER];
     int conn_count;
     int notify_pipe[2];  // [0] - чтение, [1] - запись
     const char *docroot;
+    int docroot_fd;      // открытый один раз каталог docroot (общий для всех)
+    int busy_poll_us;    // активный опрос перед сном, 0 - выключено
+    enum sock_profile sock_profile;
+    struct proxy_pool proxy_pool; // keep-alive соединения с upstream'ами
     volatile int shutdown;
+    volatile int draining;    // новые соединения не назначаются, выход при conn_count == 0
+    volatile int exited;      // поток завершился, можно pthread_join
+    unsigned long long busy_us;      // время обработки событий (вне poll), нарастающим итогом
+    unsigned long long last_busy_us; // значение на прошлой оценке (поток пула)
 };
 
-static struct worker *workers = NULL;
-static int worker_count = 0;
+// Слоты пула: worker_slots указателей, NULL - слот свободен.
+// Состав пула меняется только под pool_mutex
+static struct worker **workers = NULL;
+static int worker_slots = 0;
+static int active_workers = 0;   // без draining
 static volatile int workers_shutdown = 0;
 static int next_worker = 0; // для round-robin
+static int docroot_fd = -1;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Управляющий поток адаптивного пула
+static struct server_config pool_cfg;
+static pthread_t manager_thread;
+static int manager_running = 0;
+static int manager_stop = 0;
+static pthread_cond_t manager_cond = PTHREAD_COND_INITIALIZER;
+
+// Метрики масштабирования (под pool_mutex)
+static struct {
+    unsigned long scale_ups;
+    unsigned long scale_downs;
+    unsigned long retired;
+} pool_stats;
 
 // Устанавливить сокет в неблокирующий режим
 static int set_nonblocking(int fd) {
@@ -69,12 +120,350 @@ static int set_nonblocking(int fd) {
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
+// Включить busy polling сокета на уровне драйвера (где поддерживается).
+// Значения выше net.core.busy_read требуют CAP_NET_ADMIN - ошибки игнорируются.
+static void set_busy_poll(int fd, int busy_poll_us) {
+#ifdef SO_BUSY_POLL
+    setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us));
+#endif
+#ifdef SO_PREFER_BUSY_POLL
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one));
+#endif
+    (void)fd;
+    (void)busy_poll_us;
+}
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Ожидание событий. В режиме busy poll - неблокирующие проверки готовности
+// в течение busy_poll_us, и только затем сон в poll()
+static int worker_poll(struct worker *w, struct pollfd *pfds, int nfds, int timeout) {
+    if (w->busy_poll_us > 0) {
+        long long deadline = monotonic_us() + w->busy_poll_us;
+        do {
+            int ready = poll(pfds, nfds, 0);
+            if (ready != 0) return ready;
+            // Уступить ядро, если на нём есть другие готовые потоки (accept, соседние worker'ы)
+            sched_yield();
+        } while (!w->shutdown && monotonic_us() < deadline);
+    }
+    return poll(pfds, nfds, timeout);
+}
+
+static const char *conn_method_name(const struct connection *conn) {
+    return conn->req.method == HTTP_METHOD_GET ? "GET" : "HEAD";
+}
+
+// Запись в лог; в сборке TRACE=1 - с длительностями фаз
+static void log_conn(const struct connection *conn, const char *method, const char *path,
+                     int status_code, size_t bytes_sent) {
+#ifdef TRACE_PHASES
+    log_request_trace(conn->ip, conn->port, method, path, status_code, bytes_sent, &conn->trace);
+#else
+    log_request(conn->ip, conn->port, method, path, status_code, bytes_sent);
+#endif
+}
+
+static const char *status_text(int status_code) {
+    switch (status_code) {
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    default:  return "Internal Server Error";
+    }
+}
+
+// Освобождение источника тела ответа
+static void conn_release_file(struct connection *conn) {
+    if (conn->bundle) {
+        bundle_release(conn->bundle); // file_fd принадлежит bundle
+        conn->bundle = NULL;
+    } else if (conn->file_fd >= 0) {
+        close(conn->file_fd);
+    }
+    conn->file_fd = -1;
+}
+
+// Ответ из bundle: без обращений к файловой системе
+static int conn_prepare_bundle(struct connection *conn, struct bundle *b) {
+    char user_path[2048];
+    int err = http_normalize_path(&conn->req, user_path, sizeof(user_path));
+    if (err != 0) return err;
+
+    struct bundle_file bf;
+    err = bundle_lookup(b, user_path, http_accepts_gzip(conn->request_buf), &bf);
+    if (err != 0) return err;
+
+    int len = http_format_header(conn->header_buf, sizeof(conn->header_buf),
+        bf.content_type, bf.length, bf.etag, bf.content_encoding, bf.has_variants);
+    if (len <= 0) return 500;
+
+    conn->header_len = len;
+    conn->file_size = bf.length;
+    conn->file_offset = bf.offset;
+    conn->file_fd = bundle_fd(b);
+    conn->bundle = b;
+    return 0;
+}
+
+// Ответ из файла в docroot
+static int conn_prepare_file(struct worker *w, struct connection *conn) {
+    long long file_size;
+    const char *content_type;
+    int err = http_open_file(w->docroot_fd, w->docroot, &conn->req, &conn->file_fd, &file_size, &content_type);
+    if (err != 0) return err;
+
+    int len = http_format_header(conn->header_buf, sizeof(conn->header_buf),
+        content_type, file_size, NULL, NULL, 0);
+    if (len <= 0) {
+        conn_release_file(conn);
+        return 500;
+    }
+
+    conn->header_len = len;
+    conn->file_size = file_size;
+    conn->file_offset = 0;
+    return 0;
+}
+
+// Подготовка заголовка и источника тела. Возврат 0 или HTTP-код ошибки
+static int conn_prepare_response(struct worker *w, struct connection *conn) {
+    int err;
+    struct bundle *b = bundle_acquire();
+    if (!b) {
+        err = conn_prepare_file(w, conn);
+    } else {
+        err = conn_prepare_bundle(conn, b);
+        if (err != 0) bundle_release(b);
+    }
+
+    // Профиль выбирается по размеру тела, до отправки первого байта
+    if (err == 0 && w->sock_profile != SOCK_PROFILE_NONE) {
+        sock_tune_connection(conn->fd, w->sock_profile, conn->file_size);
+    }
+    return err;
+}
+
+// Ответ отправлен полностью
+static void conn_response_done(struct connection *conn) {
+    TRACE_MARK(&conn->trace, conn->fd, TRACE_SEND_LAST);
+#ifdef TRACE_PHASES
+    // Успешные ответы логируются только при трассировке - ради строки фаз
+    log_conn(conn, conn_method_name(conn), conn->req.path, 200,
+             conn->header_bytes_sent + conn->body_bytes_sent);
+#endif
+    conn->state = CONN_DONE;
+}
+
+// === Проксирование ===
+
+// Завершение проксируемого запроса: соединение с upstream'ом - в пул или закрыть
+static void conn_release_proxy(struct worker *w, struct connection *conn) {
+    if (conn->proxy) {
+        proxy_finish(&w->proxy_pool, conn->proxy);
+        conn->proxy = NULL;
+    }
+}
+
+// Ответ upstream'а передан клиенту полностью
+static void conn_proxy_done(struct connection *conn) {
+    TRACE_MARK(&conn->trace, conn->fd, TRACE_SEND_LAST);
+#ifndef TRACE_PHASES
+    // Как и для статики, успешные ответы логируются только при трассировке
+    if (conn->proxy->status >= 400)
+#endif
+    log_conn(conn, conn_method_name(conn), conn->req.path, conn->proxy->status,
+             conn->proxy->bytes_to_client);
+    conn->state = CONN_DONE;
+}
+
+// Ошибка upstream'а: 502, если клиенту ещё ничего не отправлено
+static void conn_proxy_fail(struct connection *conn) {
+    if (conn->state != CONN_PROXY_BODY && conn->proxy->out_sent == 0) {
+        send_simple_response(conn->fd, 502, status_text(502));
+        log_conn(conn, conn_method_name(conn), conn->req.path, 502, 0);
+    } else {
+        log_conn(conn, conn_method_name(conn), conn->req.path, conn->proxy->status,
+                 conn->proxy->bytes_to_client);
+    }
+    conn->state = CONN_DONE;
+}
+
+static void conn_proxy_io(struct connection *conn, short client_revents, short upstream_revents);
+
+// Повтор запроса на новом соединении вместо закрытого из пула
+static void conn_proxy_retry(struct connection *conn) {
+    if (conn->proxy->connected) {
+        conn->state = CONN_PROXY_SENDING;
+        conn_proxy_io(conn, 0, POLLOUT);
+    } else {
+        conn->state = CONN_PROXY_CONNECTING;
+    }
+}
+
+// Шаг state machine проксируемого запроса по событиям клиента и upstream'а.
+// Завершённый шаг сразу переходит к следующему, если сокет наверняка готов
+static void conn_proxy_io(struct connection *conn, short client_revents, short upstream_revents) {
+    struct proxy_conn *pc = conn->proxy;
+    enum proxy_step r;
+
+    if (conn->state == CONN_PROXY_CONNECTING) {
+        if (!(upstream_revents & (POLLOUT | POLLERR | POLLHUP))) return;
+        if (proxy_connect_result(pc) != PROXY_DONE) {
+            conn_proxy_fail(conn);
+            return;
+        }
+        conn->state = CONN_PROXY_SENDING;
+        upstream_revents |= POLLOUT;
+    }
+
+    if (conn->state == CONN_PROXY_SENDING) {
+        if (!(upstream_revents & (POLLOUT | POLLERR | POLLHUP))) return;
+        r = proxy_send_request(pc);
+        if (r == PROXY_ERROR) conn_proxy_fail(conn);
+        if (r == PROXY_RETRY) conn_proxy_retry(conn);
+        if (r == PROXY_DONE) conn->state = CONN_PROXY_WAITING;
+        return;
+    }
+
+    if (conn->state == CONN_PROXY_WAITING) {
+        if (!(upstream_revents & (POLLIN | POLLERR | POLLHUP))) return;
+        r = proxy_recv_header(pc, conn->req.method == HTTP_METHOD_HEAD);
+        if (r == PROXY_ERROR) conn_proxy_fail(conn);
+        if (r == PROXY_RETRY) conn_proxy_retry(conn);
+        if (r != PROXY_DONE) return;
+        conn->state = CONN_PROXY_HEADER;
+        client_revents |= POLLOUT;
+    }
+
+    if (conn->state == CONN_PROXY_HEADER) {
+        if (!(client_revents & POLLOUT)) return;
+        size_t sent_before = pc->out_sent;
+        r = proxy_send_header(pc, conn->fd);
+        if (sent_before == 0 && pc->out_sent > 0) {
+            TRACE_MARK(&conn->trace, conn->fd, TRACE_SEND_FIRST);
+        }
+        if (r == PROXY_ERROR) conn->state = CONN_DONE;
+        if (r != PROXY_DONE) return;
+        if (pc->complete) {
+            conn_proxy_done(conn);
+            return;
+        }
+        conn->state = CONN_PROXY_BODY;
+        return;
+    }
+
+    if (conn->state == CONN_PROXY_BODY) {
+        r = proxy_splice_body(pc, conn->fd, upstream_revents & (POLLIN | POLLERR | POLLHUP),
+                              client_revents & POLLOUT);
+        if (r == PROXY_ERROR) conn_proxy_fail(conn);
+        if (r == PROXY_DONE) conn_proxy_done(conn);
+    }
+}
+
+// Запрос по маршруту route: соединение с upstream'ом и отправка запроса
+static void conn_proxy_start(struct worker *w, struct connection *conn, int route) {
+    int err = proxy_begin(&w->proxy_pool, route, &conn->req, conn->request_buf, conn->ip, &conn->proxy);
+    if (err != 0) {
+        send_simple_response(conn->fd, err, status_text(err));
+        log_conn(conn, conn_method_name(conn), conn->req.path, err, 0);
+        conn->state = CONN_DONE;
+        return;
+    }
+
+    TRACE_MARK(&conn->trace, conn->fd, TRACE_RESOLVED);
+    if (w->sock_profile != SOCK_PROFILE_NONE) {
+        sock_tune_connection(conn->fd, w->sock_profile, 0); // размер ответа заранее неизвестен
+    }
+
+    if (conn->proxy->connected) {
+        // Соединение из пула готово к записи - запрос уходит сразу
+        conn->state = CONN_PROXY_SENDING;
+        conn_proxy_io(conn, 0, POLLOUT);
+    } else {
+        conn->state = CONN_PROXY_CONNECTING;
+    }
+}
+
+// События pollfd для проксируемого запроса: клиента и upstream'а
+static void conn_proxy_events(const struct connection *conn, short *client_events, short *upstream_events) {
+    *client_events = 0;
+    *upstream_events = 0;
+    switch (conn->state) {
+    case CONN_PROXY_CONNECTING:
+    case CONN_PROXY_SENDING:
+        *upstream_events = POLLOUT;
+        break;
+    case CONN_PROXY_WAITING:
+        *upstream_events = POLLIN;
+        break;
+    case CONN_PROXY_HEADER:
+        *client_events = POLLOUT;
+        break;
+    case CONN_PROXY_BODY:
+        if (proxy_want_upstream(conn->proxy)) *upstream_events = POLLIN;
+        if (proxy_want_client(conn->proxy)) *client_events = POLLOUT;
+        break;
+    default:
+        break;
+    }
+}
+
+// Приём переданных через notify_pipe соединений. Возврат числа прочитанных сообщений
+static int worker_accept_pending(struct worker *w) {
+    struct conn_msg msg;
+    int count = 0;
+    while (read(w->notify_pipe[0], &msg, sizeof(msg)) == sizeof(msg)) {
+        count++;
+        if (msg.fd < 0) continue; // пробуждение (остановка пула)
+
+        if (w->conn_count < MAX_CONNECTIONS_PER_WORKER) {
+            int idx = w->conn_count++;
+            struct connection *conn = &w->conns[idx];
+            conn->fd = msg.fd;
+            snprintf(conn->ip, sizeof(conn->ip), "%s", msg.ip);
+            conn->port = msg.port;
+            conn->request_len = 0;
+            conn->state = CONN_READING;
+            conn->file_fd = -1;
+            conn->file_offset = 0;
+            conn->bundle = NULL;
+            conn->proxy = NULL;
+            memset(&conn->trace, 0, sizeof(conn->trace));
+            conn->trace.ns[TRACE_ACCEPT] = msg.accept_ns;
+            set_nonblocking(msg.fd);
+            if (w->busy_poll_us > 0) {
+                set_busy_poll(msg.fd, w->busy_poll_us);
+            }
+        } else {
+            close(msg.fd); // перегрузка
+        }
+    }
+    return count;
+}
+
 // Основной цикл worker-потока
 static void* worker_thread(void *arg) {
     struct worker *w = (struct worker*)arg;
-    struct pollfd pfds[MAX_CONNECTIONS_PER_WORKER + 1]; // +1 для notify_pipe
+    // notify_pipe, клиентские сокеты, затем сокеты upstream'ов проксируемых запросов
+    struct pollfd pfds[2 * MAX_CONNECTIONS_PER_WORKER + 1];
+    short upstream_events[MAX_CONNECTIONS_PER_WORKER];
+    int upstream_pfd[MAX_CONNECTIONS_PER_WORKER]; // индекс в pfds, -1 - нет
 
     while (!w->shutdown) {
+        // 0. Выводимый из пула worker завершается, обслужив все соединения
+        if (w->draining && w->conn_count == 0 && worker_accept_pending(w) == 0) {
+            break;
+        }
+
         // 1. Подготовка pollfd: notify_pipe
         pfds[0].fd = w->notify_pipe[0];
         pfds[0].events = POLLIN;
@@ -85,6 +474,12 @@ static void* worker_thread(void *arg) {
             pfds[nfds].fd = w->conns[i].fd;
             pfds[nfds].events = POLLIN;
 
+            if (w->conns[i].proxy) {
+                conn_proxy_events(&w->conns[i], &pfds[nfds].events, &upstream_events[i]);
+                nfds++;
+                continue;
+            }
+
             // Добавляем POLLOUT, если соединение в состоянии отправки
             if (w->conns[i].state == CONN_SENDING_HEADER ||
                 w->conns[i].state == CONN_SENDING_BODY) {
@@ -92,35 +487,31 @@ static void* worker_thread(void *arg) {
             }
             nfds++;
         }
+        int polled = w->conn_count;
+
+        // 2.1. Сокеты upstream'ов - после всех клиентских
+        for (int i = 0; i < polled; i++) {
+            upstream_pfd[i] = -1;
+            if (w->conns[i].proxy && upstream_events[i] != 0) {
+                pfds[nfds].fd = w->conns[i].proxy->upstream_fd;
+                pfds[nfds].events = upstream_events[i];
+                upstream_pfd[i] = nfds++;
+            }
+        }
 
         // 3. Ожидание событий
         int effective_timeout = (w->conn_count == 0) ? 500 : -1;
-        int ready = poll(pfds, nfds, effective_timeout);
+        int ready = worker_poll(w, pfds, nfds, effective_timeout);
         if (ready <= 0) continue;
+        long long wake_us = monotonic_us();
 
         // 4. Обработка уведомлений (новые соединения)
         if (pfds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
-            struct conn_msg msg;
-            ssize_t n;
-            while ((n = read(w->notify_pipe[0], &msg, sizeof(msg))) == sizeof(msg)) {
-                if (w->conn_count < MAX_CONNECTIONS_PER_WORKER) {
-                    int idx = w->conn_count++;
-                    struct connection *conn = &w->conns[idx];
-                    conn->fd = msg.fd;
-                    snprintf(conn->ip, sizeof(conn->ip), "%s", msg.ip);
-                    conn->port = msg.port;
-                    conn->request_len = 0;
-                    conn->state = CONN_READING;
-                    conn->file_fd = -1;
-                    set_nonblocking(msg.fd);
-                } else {
-                    close(msg.fd); // перегрузка
-                }
-            }
+            worker_accept_pending(w);
         }
 
         // 5. Обработка клиентских сокетов
-        for (int i = 1; i < nfds; i++) {
+        for (int i = 1; i <= polled; i++) {
             int idx = i - 1;
             if (idx >= w->conn_count) continue; // защита от изменения во время цикла
 
@@ -132,6 +523,12 @@ static void* worker_thread(void *arg) {
                 continue;
             }
 
+            if (conn->proxy) {
+                conn_proxy_io(conn, pfds[i].revents,
+                              upstream_pfd[idx] >= 0 ? pfds[upstream_pfd[idx]].revents : 0);
+                continue;
+            }
+
             // Чтение запроса (если ещё не прочитан)
             if ((pfds[i].revents & POLLIN) && conn->state == CONN_READING) {
                 ssize_t n = recv(conn->fd,
@@ -139,69 +536,44 @@ static void* worker_thread(void *arg) {
                     sizeof(conn->request_buf) - conn->request_len - 1,
                     MSG_NOSIGNAL);
                 if (n > 0) {
+                    if (conn->request_len == 0) {
+                        TRACE_MARK(&conn->trace, conn->fd, TRACE_FIRST_BYTE);
+                    }
                     conn->request_len += n;
                     conn->request_buf[conn->request_len] = '\0';
 
                     char *end = strstr(conn->request_buf, "\r\n\r\n");
                     if (end) {
                         *end = '\0';
+                        TRACE_MARK(&conn->trace, conn->fd, TRACE_HEADERS);
                         if (http_parse_request_line(conn->request_buf, &conn->req)) {
                             snprintf(conn->req.client_ip, sizeof(conn->req.client_ip), "%s", conn->ip);
                             conn->req.client_port = conn->port;
 
-                            char resolved_path[4096];
-                            long long file_size;
-                            const char *content_type;
-                            int err = http_prepare_response(w->docroot, &conn->req, resolved_path, &file_size, &content_type);
-
-                            if (err != 0) {
-                                send_simple_response(conn->fd, err,
-                                    err == 400 ? "Bad Request" :
-                                    err == 403 ? "Forbidden" :
-                                    err == 404 ? "Not Found" : "Payload Too Large");
-                                log_request(conn->ip, conn->port,
-                                    conn->req.method == HTTP_METHOD_GET ? "GET" : "HEAD",
-                                    conn->req.path, err, 0);
-                                conn->state = CONN_DONE;
+                            int route = proxy_match(conn->req.path);
+                            if (route >= 0) {
+                                conn_proxy_start(w, conn, route);
                             } else {
-                                conn->file_fd = open(resolved_path, O_RDONLY);
-                                if (conn->file_fd < 0) {
-                                    send_simple_response(conn->fd, 404, "Not Found");
-                                    log_request(conn->ip, conn->port,
-                                        conn->req.method == HTTP_METHOD_GET ? "GET" : "HEAD",
-                                        conn->req.path, 404, 0);
+                                int err = conn_prepare_response(w, conn);
+                                if (err != 0) {
+                                    send_simple_response(conn->fd, err, status_text(err));
+                                    log_conn(conn, conn_method_name(conn), conn->req.path, err, 0);
                                     conn->state = CONN_DONE;
                                 } else {
-                                    conn->file_size = file_size;
-                                    int len = snprintf(conn->header_buf, sizeof(conn->header_buf),
-                                        "HTTP/1.1 200 OK\r\n"
-                                        "Content-Type: %s\r\n"
-                                        "Content-Length: %lld\r\n"
-                                        "Connection: close\r\n"
-                                        "\r\n",
-                                        content_type, file_size);
-                                    if (len <= 0 || len >= (int)sizeof(conn->header_buf)) {
-                                        close(conn->file_fd);
-                                        send_simple_response(conn->fd, 500, "Internal Server Error");
-                                        log_request(conn->ip, conn->port, "GET", "/", 500, 0);
-                                        conn->state = CONN_DONE;
-                                        conn->file_fd = -1;
-                                    } else {
-                                        conn->header_len = len;
-                                        conn->header_bytes_sent = 0;
-                                        conn->body_bytes_sent = 0;
-                                        conn->state = CONN_SENDING_HEADER;
-                                    }
+                                    TRACE_MARK(&conn->trace, conn->fd, TRACE_RESOLVED);
+                                    conn->header_bytes_sent = 0;
+                                    conn->body_bytes_sent = 0;
+                                    conn->state = CONN_SENDING_HEADER;
                                 }
                             }
                         } else {
                             send(conn->fd, "HTTP/1.1 405 Method Not Allowed\r\nConnection: close\r\n\r\n", 63, MSG_NOSIGNAL);
-                            log_request(conn->ip, conn->port, "UNKNOWN", "/", 405, 0);
+                            log_conn(conn, "UNKNOWN", "/", 405, 0);
                             conn->state = CONN_DONE;
                         }
                     } else if (conn->request_len >= sizeof(conn->request_buf) - 1) {
                         send(conn->fd, "HTTP/1.1 413 Payload Too Large\r\nConnection: close\r\n\r\n", 60, MSG_NOSIGNAL);
-                        log_request(conn->ip, conn->port, "UNKNOWN", "/", 413, 0);
+                        log_conn(conn, "UNKNOWN", "/", 413, 0);
                         conn->state = CONN_DONE;
                     }
                 } else if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
@@ -216,10 +588,13 @@ static void* worker_thread(void *arg) {
                     conn->header_len - conn->header_bytes_sent,
                     MSG_NOSIGNAL);
                 if (sent > 0) {
+                    if (conn->header_bytes_sent == 0) {
+                        TRACE_MARK(&conn->trace, conn->fd, TRACE_SEND_FIRST);
+                    }
                     conn->header_bytes_sent += sent;
                     if (conn->header_bytes_sent == conn->header_len) {
                         if (conn->req.method == HTTP_METHOD_HEAD || conn->file_size == 0) {
-                            conn->state = CONN_DONE;
+                            conn_response_done(conn);
                         } else {
                             conn->state = CONN_SENDING_BODY;
                         }
@@ -231,12 +606,13 @@ static void* worker_thread(void *arg) {
 
             // Отправка тела
             if ((pfds[i].revents & POLLOUT) && conn->state == CONN_SENDING_BODY) {
-                ssize_t sent = sendfile(conn->fd, conn->file_fd, NULL,
+                off_t offset = conn->file_offset + conn->body_bytes_sent;
+                ssize_t sent = sendfile(conn->fd, conn->file_fd, &offset,
                                         conn->file_size - conn->body_bytes_sent);
                 if (sent > 0) {
                     conn->body_bytes_sent += sent;
                     if (conn->body_bytes_sent >= (size_t)conn->file_size) {
-                        conn->state = CONN_DONE;
+                        conn_response_done(conn);
                     }
                 } else if (sent == 0 || (sent < 0 && !(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))) {
                     conn->state = CONN_DONE;
@@ -247,9 +623,8 @@ static void* worker_thread(void *arg) {
         // 6. Удаление завершённых соединений
         for (int i = 0; i < w->conn_count; ) {
             if (w->conns[i].state == CONN_DONE) {
-                if (w->conns[i].file_fd >= 0) {
-                    close(w->conns[i].file_fd);
-                }
+                conn_release_file(&w->conns[i]);
+                conn_release_proxy(w, &w->conns[i]);
                 close(w->conns[i].fd);
                 // Переместить последний элемент на место удаляемого
                 if (i != w->conn_count - 1) {
@@ -261,52 +636,210 @@ static void* worker_thread(void *arg) {
                 i++;
             }
         }
+
+        __sync_fetch_and_add(&w->busy_us, (unsigned long long)(monotonic_us() - wake_us));
     }
 
     // Финальная очистка
     for (int i = 0; i < w->conn_count; i++) {
-        if (w->conns[i].file_fd >= 0) close(w->conns[i].file_fd);
+        conn_release_file(&w->conns[i]);
+        conn_release_proxy(w, &w->conns[i]);
         close(w->conns[i].fd);
     }
+    proxy_pool_close(&w->proxy_pool);
+    // notify_pipe закрывает владелец пула (worker_free): в него ещё могут писать
+    w->exited = 1;
+    return NULL;
+}
+
+// === Управление составом пула ===
+
+// Создание worker'а в слоте slot (под pool_mutex или до старта пула)
+static int worker_spawn(int slot) {
+    struct worker *w = calloc(1, sizeof(struct worker));
+    if (!w) return -1;
+
+    w->id = slot;
+    w->docroot = pool_cfg.docroot;
+    w->docroot_fd = docroot_fd;
+    w->busy_poll_us = pool_cfg.busy_poll_us;
+    w->sock_profile = pool_cfg.sock_profile;
+
+    if (pipe(w->notify_pipe) != 0) {
+        perror("pipe");
+        free(w);
+        return -1;
+    }
+
+    // Сделать pipe неблокирующим. Запись - тоже: переполненный pipe одного
+    // worker'а не должен останавливать accept под pool_mutex
+    set_nonblocking(w->notify_pipe[0]);
+    set_nonblocking(w->notify_pipe[1]);
+
+    if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
+        close(w->notify_pipe[0]);
+        close(w->notify_pipe[1]);
+        free(w);
+        return -1;
+    }
+
+    workers[slot] = w;
+    active_workers++;
+    return 0;
+}
+
+// Ожидание завершения потока и освобождение памяти worker'а (вместе с conns)
+static void worker_free(int slot) {
+    struct worker *w = workers[slot];
+    pthread_join(w->thread, NULL);
     close(w->notify_pipe[0]);
     close(w->notify_pipe[1]);
+    free(w);
+    workers[slot] = NULL;
+}
+
+// Одна оценка нагрузки: рост при высокой загрузке цикла событий или
+// длинной очереди соединений, сокращение - после серии тихих интервалов
+static void pool_rebalance(long long elapsed_us, int *low_streak) {
+    // Завершившиеся после вывода из пула worker'ы
+    for (int i = 0; i < worker_slots; i++) {
+        if (workers[i] && workers[i]->draining && workers[i]->exited) {
+            worker_free(i);
+            pool_stats.retired++;
+            log_event("pool: worker %d retired (active=%d retired=%lu)",
+                      i, active_workers, pool_stats.retired);
+        }
+    }
+
+    double util_sum = 0;
+    int conn_sum = 0;
+    int idlest = -1;
+    int free_slot = -1;
+    for (int i = 0; i < worker_slots; i++) {
+        struct worker *w = workers[i];
+        if (!w) {
+            if (free_slot < 0) free_slot = i;
+            continue;
+        }
+        if (w->draining) continue;
+
+        unsigned long long busy = __sync_fetch_and_add(&w->busy_us, 0);
+        util_sum += (double)(busy - w->last_busy_us) / elapsed_us;
+        w->last_busy_us = busy;
+
+        int conns = w->conn_count;
+        conn_sum += conns;
+        if (idlest < 0 || conns < workers[idlest]->conn_count) idlest = i;
+    }
+    if (active_workers == 0) return;
+
+    double util = util_sum / active_workers;
+    double conns_per_worker = (double)conn_sum / active_workers;
+
+    if ((util > POOL_SCALE_UP_UTIL || conns_per_worker > POOL_SCALE_UP_CONNS) &&
+        active_workers < pool_cfg.worker_max && free_slot >= 0) {
+        *low_streak = 0;
+        if (worker_spawn(free_slot) == 0) {
+            pool_stats.scale_ups++;
+            log_event("pool: scale up, worker %d started (active=%d util=%.2f conns_per_worker=%.1f scale_ups=%lu scale_downs=%lu)",
+                      free_slot, active_workers, util, conns_per_worker,
+                      pool_stats.scale_ups, pool_stats.scale_downs);
+        }
+        return;
+    }
+
+    if (util < POOL_SCALE_DOWN_UTIL && conns_per_worker < POOL_SCALE_DOWN_CONNS &&
+        active_workers > pool_cfg.worker_min) {
+        if (++*low_streak < POOL_SCALE_DOWN_STREAK) return;
+        *low_streak = 0;
+
+        workers[idlest]->draining = 1;
+        active_workers--;
+        pool_stats.scale_downs++;
+        log_event("pool: scale down, worker %d draining (conns=%d active=%d util=%.2f conns_per_worker=%.1f scale_ups=%lu scale_downs=%lu)",
+                  idlest, workers[idlest]->conn_count, active_workers, util, conns_per_worker,
+                  pool_stats.scale_ups, pool_stats.scale_downs);
+        return;
+    }
+
+    *low_streak = 0;
+}
+
+static void *pool_manager_thread(void *arg) {
+    (void)arg;
+    int low_streak = 0;
+    long long last_us = monotonic_us();
+
+    pthread_mutex_lock(&pool_mutex);
+    while (!manager_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += POOL_SCALE_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (POOL_SCALE_INTERVAL_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&manager_cond, &pool_mutex, &deadline);
+        if (manager_stop) break;
+
+        long long now_us = monotonic_us();
+        if (now_us > last_us) {
+            pool_rebalance(now_us - last_us, &low_streak);
+        }
+        last_us = now_us;
+    }
+    pthread_mutex_unlock(&pool_mutex);
     return NULL;
 }
 
 // === Публичные функции ===
 
-int worker_pool_start(const char *docroot, int thread_count) {
-    if (thread_count <= 0 || !docroot) return -1;
+int worker_pool_start(const struct server_config *cfg) {
+    if (!cfg || cfg->worker_count <= 0 || !cfg->docroot) return -1;
 
-    workers = calloc(thread_count, sizeof(struct worker));
-    if (!workers) return -1;
+    pool_cfg = *cfg;
+    int adaptive = cfg->worker_max > 0;
+    if (!adaptive) {
+        pool_cfg.worker_min = pool_cfg.worker_max = cfg->worker_count;
+    }
 
-    worker_count = thread_count;
+    // Каталог docroot открывается один раз: пути разрешаются относительно него
+    docroot_fd = open(cfg->docroot, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (docroot_fd < 0 && !cfg->bundle_path) {
+        perror("open docroot");
+        return -1;
+    }
+
+    worker_slots = pool_cfg.worker_max;
+    workers = calloc(worker_slots, sizeof(struct worker*));
+    if (!workers) {
+        if (docroot_fd >= 0) close(docroot_fd);
+        docroot_fd = -1;
+        return -1;
+    }
+
+    active_workers = 0;
     workers_shutdown = 0;
     next_worker = 0;
+    memset(&pool_stats, 0, sizeof(pool_stats));
 
-    for (int i = 0; i < thread_count; i++) {
-        struct worker *w = &workers[i];
-        w->docroot = docroot;
-        w->conn_count = 0;
-        w->shutdown = 0;
-
-        if (pipe(w->notify_pipe) != 0) {
-            perror("pipe");
+    for (int i = 0; i < cfg->worker_count; i++) {
+        if (worker_spawn(i) != 0) {
             worker_pool_stop();
             return -1;
         }
+    }
 
-        // Сделать pipe неблокирующим
-        int flags = fcntl(w->notify_pipe[0], F_GETFL, 0);
-        fcntl(w->notify_pipe[0], F_SETFL, flags | O_NONBLOCK);
-
-        if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
-            close(w->notify_pipe[0]);
-            close(w->notify_pipe[1]);
+    if (adaptive) {
+        manager_stop = 0;
+        if (pthread_create(&manager_thread, NULL, pool_manager_thread, NULL) != 0) {
             worker_pool_stop();
             return -1;
         }
+        manager_running = 1;
+        log_event("pool: adaptive, %d..%d workers, started with %d",
+                  pool_cfg.worker_min, pool_cfg.worker_max, active_workers);
     }
     return 0;
 }
@@ -314,43 +847,81 @@ int worker_pool_start(const char *docroot, int thread_count) {
 int worker_pool_stop(void) {
     if (!workers) return -1;
 
+    pthread_mutex_lock(&pool_mutex);
     workers_shutdown = 1;
-    for (int i = 0; i < worker_count; i++) {
-        workers[i].shutdown = 1;
+    manager_stop = 1;
+    pthread_cond_signal(&manager_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    if (manager_running) {
+        pthread_join(manager_thread, NULL);
+        manager_running = 0;
+    }
+
+    for (int i = 0; i < worker_slots; i++) {
+        struct worker *w = workers[i];
+        if (!w) continue;
+
+        w->shutdown = 1;
         // Пробудить worker, чтобы он вышел из poll()
-        struct conn_msg dummy = { -1, "", 0 };
-        ssize_t written = write(workers[i].notify_pipe[1], &dummy, sizeof(dummy));
-        if (written != sizeof(dummy)) {
-            perror("Warning: failed to notify worker during shutdown");
+        if (!w->exited) {
+            struct conn_msg dummy = { -1, "", 0, 0 };
+            ssize_t written = write(w->notify_pipe[1], &dummy, sizeof(dummy));
+            // Полный pipe - worker и так проснётся и увидит shutdown
+            if (written != sizeof(dummy) && errno != EAGAIN) {
+                perror("Warning: failed to notify worker during shutdown");
+            }
         }
-        pthread_join(workers[i].thread, NULL);
+        worker_free(i);
     }
 
     free(workers);
     workers = NULL;
-    worker_count = 0;
+    worker_slots = 0;
+    active_workers = 0;
+
+    if (docroot_fd >= 0) close(docroot_fd);
+    docroot_fd = -1;
     return 0;
 }
 
 int worker_assign_connection(int client_fd, const char *ip, int port) {
-    if (!workers || workers_shutdown) {
+    pthread_mutex_lock(&pool_mutex);
+    if (!workers || workers_shutdown || active_workers == 0) {
+        pthread_mutex_unlock(&pool_mutex);
         close(client_fd);
         return -1;
     }
 
-    int target = __sync_fetch_and_add(&next_worker, 1) % worker_count;
-    struct worker *w = &workers[target];
-
     struct conn_msg msg = {0};
     msg.fd = client_fd;
     snprintf(msg.ip, sizeof(msg.ip), "%s", ip);
     msg.port = port;
+#ifdef TRACE_PHASES
+    msg.accept_ns = trace_now_ns();
+#endif
+    TRACE_PROBE(client_fd, TRACE_ACCEPT);
+
+    // Round-robin по занятым слотам, выводимые из пула пропускаются.
+    // Запись под pool_mutex: worker не может начать вывод из пула между
+    // выбором и записью, так что сообщение не потеряется. Запись неблокирующая
+    // (сообщение меньше PIPE_BUF - целиком или EAGAIN): при полном pipe
+    // соединение уходит следующему worker'у
+    ssize_t written = -1;
+    for (int n = 0; n < worker_slots && written != sizeof(msg); n++) {
+        struct worker *w = workers[next_worker];
+        next_worker = (next_worker + 1) % worker_slots;
+        if (w && !w->draining) {
+            written = write(w->notify_pipe[1], &msg, sizeof(msg));
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
 
-    // Запись в pipe не блокируя главный поток
-    if (write(w->notify_pipe[1], &msg, sizeof(msg)) != sizeof(msg)) {
+    if (written != sizeof(msg)) {
+        // Все worker'ы перегружены
         close(client_fd);
         return -1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,316 @@
+// Упаковка docroot в bundle-файл (формат - inc/bundle.h).
+// Файл "<path>.gz" рядом с "<path>" становится его предсжатым вариантом.
+// Результат пишется во временный файл и атомарно переименовывается,
+// после чего работающему серверу достаточно SIGHUP.
+
+#include "bundle.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define MAX_FILE_SIZE (128LL * 1024 * 1024)   // как в http_prepare_response
+#define DATA_ALIGN    64
+#define ETAG_LEN      18                      // "\"%016llx\""
+#define COPY_BUF_SIZE (256 * 1024)
+
+struct pack_file {
+    char *url;            // "/css/styles.css"
+    char *fs_path;
+    long long size;
+    struct bundle_entry entry;
+};
+
+struct pack_list {
+    struct pack_file *items;
+    size_t count;
+    size_t capacity;
+};
+
+static int list_add(struct pack_list *list, const char *url, const char *fs_path, long long size) {
+    if (list->count == list->capacity) {
+        size_t cap = list->capacity ? list->capacity * 2 : 64;
+        struct pack_file *items = realloc(list->items, cap * sizeof(*items));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = cap;
+    }
+
+    struct pack_file *f = &list->items[list->count];
+    memset(f, 0, sizeof(*f));
+    f->url = strdup(url);
+    f->fs_path = strdup(fs_path);
+    f->size = size;
+    if (!f->url || !f->fs_path) return -1;
+    list->count++;
+    return 0;
+}
+
+// Рекурсивный обход каталога; символьные ссылки на каталоги не обходятся
+static int collect(struct pack_list *list, const char *dir, const char *url_prefix) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return -1;
+    }
+
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+
+        char fs_path[4096], url[2048];
+        if (snprintf(fs_path, sizeof(fs_path), "%s/%s", dir, de->d_name) >= (int)sizeof(fs_path) ||
+            snprintf(url, sizeof(url), "%s/%s", url_prefix, de->d_name) >= (int)sizeof(url)) {
+            fprintf(stderr, "Path too long, skipped: %s/%s\n", dir, de->d_name);
+            continue;
+        }
+
+        struct stat lst, st;
+        if (lstat(fs_path, &lst) != 0 || stat(fs_path, &st) != 0) {
+            perror(fs_path);
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (S_ISLNK(lst.st_mode)) {
+                fprintf(stderr, "Symlinked directory, skipped: %s\n", fs_path);
+                continue;
+            }
+            if (collect(list, fs_path, url) != 0) {
+                closedir(d);
+                return -1;
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            if (st.st_size > MAX_FILE_SIZE) {
+                fprintf(stderr, "File too large, skipped: %s\n", fs_path);
+                continue;
+            }
+            if (list_add(list, url, fs_path, (long long)st.st_size) != 0) {
+                closedir(d);
+                return -1;
+            }
+        }
+    }
+
+    closedir(d);
+    return 0;
+}
+
+static int cmp_url(const void *a, const void *b) {
+    return strcmp(((const struct pack_file*)a)->url, ((const struct pack_file*)b)->url);
+}
+
+static uint64_t align_up(uint64_t v, uint64_t a) {
+    return (v + a - 1) / a * a;
+}
+
+static int write_all(int fd, const void *buf, size_t len, off_t offset) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+// Копирование файла в bundle с одновременным подсчётом ETag (FNV-1a содержимого)
+static int copy_file(int out_fd, const struct pack_file *f, char *buf, uint64_t *hash) {
+    int in_fd = open(f->fs_path, O_RDONLY);
+    if (in_fd < 0) {
+        perror(f->fs_path);
+        return -1;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    uint64_t copied = 0;
+    ssize_t n;
+    while ((n = read(in_fd, buf, COPY_BUF_SIZE)) > 0) {
+        if (copied + (uint64_t)n > f->entry.length) break; // файл вырос во время упаковки
+        for (ssize_t i = 0; i < n; i++) {
+            h ^= (unsigned char)buf[i];
+            h *= 1099511628211ULL;
+        }
+        if (write_all(out_fd, buf, n, (off_t)(f->entry.offset + copied)) != 0) {
+            perror("write bundle");
+            close(in_fd);
+            return -1;
+        }
+        copied += n;
+    }
+    close(in_fd);
+
+    if (n != 0 || copied != f->entry.length) {
+        fprintf(stderr, "File changed while packing: %s\n", f->fs_path);
+        return -1;
+    }
+    *hash = h;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <docroot> <bundle>\n", argv[0]);
+        return 1;
+    }
+
+    const char *docroot = argv[1];
+    const char *out_path = argv[2];
+
+    struct pack_list list = {0};
+    if (collect(&list, docroot, "") != 0) return 1;
+    qsort(list.items, list.count, sizeof(*list.items), cmp_url);
+
+    // Раскладка: заголовок, индекс, записи, строки, данные
+    uint32_t bucket_count = 1;
+    while (bucket_count < list.count * 2) bucket_count <<= 1;
+
+    uint64_t buckets_offset = sizeof(struct bundle_header);
+    uint64_t entries_offset = align_up(buckets_offset + (uint64_t)bucket_count * sizeof(uint32_t), sizeof(uint64_t));
+    uint64_t strings_offset = entries_offset + (uint64_t)list.count * sizeof(struct bundle_entry);
+
+    // Пустая строка по смещению 0 - ETag отсутствующего сжатого варианта
+    uint64_t strings_size = 1;
+    for (size_t i = 0; i < list.count; i++) {
+        strings_size += strlen(list.items[i].url) + 1;
+        strings_size += strlen(get_content_type(list.items[i].url)) + 1;
+        strings_size += ETAG_LEN + 1;
+    }
+    if (strings_size > UINT32_MAX) {
+        fprintf(stderr, "Too many files\n");
+        return 1;
+    }
+
+    char *strings = calloc(1, strings_size);
+    uint32_t *buckets = malloc((size_t)bucket_count * sizeof(uint32_t));
+    char *copy_buf = malloc(COPY_BUF_SIZE);
+    if (!strings || !buckets || !copy_buf) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    uint64_t str_off = 1;
+    uint64_t data_off = align_up(strings_offset + strings_size, DATA_ALIGN);
+    for (size_t i = 0; i < list.count; i++) {
+        struct pack_file *f = &list.items[i];
+        struct bundle_entry *e = &f->entry;
+        const char *ctype = get_content_type(f->url);
+
+        e->hash = bundle_hash(f->url);
+        e->path = (uint32_t)str_off;
+        str_off += sprintf(strings + str_off, "%s", f->url) + 1;
+        e->content_type = (uint32_t)str_off;
+        str_off += sprintf(strings + str_off, "%s", ctype) + 1;
+        e->etag = (uint32_t)str_off;
+        str_off += ETAG_LEN + 1;
+        e->offset = data_off;
+        e->length = (uint64_t)f->size;
+        data_off = align_up(data_off + e->length, DATA_ALIGN);
+    }
+
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", out_path, (int)getpid()) >= (int)sizeof(tmp_path)) {
+        fprintf(stderr, "Path too long: %s\n", out_path);
+        return 1;
+    }
+
+    int out_fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        perror(tmp_path);
+        return 1;
+    }
+
+    int failed = 0;
+    long long total = 0;
+    for (size_t i = 0; i < list.count && !failed; i++) {
+        struct pack_file *f = &list.items[i];
+        uint64_t hash;
+        if (copy_file(out_fd, f, copy_buf, &hash) != 0) {
+            failed = 1;
+            break;
+        }
+        snprintf(strings + f->entry.etag, ETAG_LEN + 1, "\"%016llx\"", (unsigned long long)hash);
+        total += f->size;
+    }
+
+    // Предсжатые варианты: "<path>.gz" ищется среди упакованных файлов
+    size_t gzip_count = 0;
+    for (size_t i = 0; i < list.count && !failed; i++) {
+        struct pack_file *f = &list.items[i];
+        char gz_url[2048 + 3];
+        snprintf(gz_url, sizeof(gz_url), "%s.gz", f->url);
+
+        struct pack_file key = { .url = gz_url };
+        struct pack_file *gz = bsearch(&key, list.items, list.count, sizeof(*list.items), cmp_url);
+        if (gz) {
+            f->entry.gzip_offset = gz->entry.offset;
+            f->entry.gzip_length = gz->entry.length;
+            f->entry.gzip_etag = gz->entry.etag;
+            gzip_count++;
+        }
+    }
+
+    // Хэш-индекс с линейным пробированием
+    for (uint32_t i = 0; i < bucket_count; i++) buckets[i] = BUNDLE_NO_ENTRY;
+    for (size_t i = 0; i < list.count; i++) {
+        uint32_t mask = bucket_count - 1;
+        uint32_t b = (uint32_t)(list.items[i].entry.hash & mask);
+        while (buckets[b] != BUNDLE_NO_ENTRY) b = (b + 1) & mask;
+        buckets[b] = (uint32_t)i;
+    }
+
+    struct bundle_header header = {0};
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+    header.version = BUNDLE_VERSION;
+    header.entry_count = (uint32_t)list.count;
+    header.bucket_count = bucket_count;
+    header.buckets_offset = buckets_offset;
+    header.entries_offset = entries_offset;
+    header.strings_offset = strings_offset;
+    header.strings_size = strings_size;
+
+    if (!failed) {
+        struct bundle_entry *entries = calloc(list.count ? list.count : 1, sizeof(*entries));
+        if (!entries) {
+            failed = 1;
+        } else {
+            for (size_t i = 0; i < list.count; i++) entries[i] = list.items[i].entry;
+            failed = write_all(out_fd, &header, sizeof(header), 0) != 0 ||
+                     write_all(out_fd, buckets, (size_t)bucket_count * sizeof(uint32_t), (off_t)buckets_offset) != 0 ||
+                     write_all(out_fd, entries, list.count * sizeof(*entries), (off_t)entries_offset) != 0 ||
+                     write_all(out_fd, strings, strings_size, (off_t)strings_offset) != 0 ||
+                     ftruncate(out_fd, (off_t)data_off) != 0 ||
+                     fsync(out_fd) != 0;
+            if (failed) perror("write bundle");
+            free(entries);
+        }
+    }
+
+    close(out_fd);
+
+    if (failed || rename(tmp_path, out_path) != 0) {
+        if (!failed) perror("rename");
+        unlink(tmp_path);
+        return 1;
+    }
+
+    printf("Packed %zu files (%lld bytes, %zu gzip variants) into %s\n",
+           list.count, total, gzip_count, out_path);
+
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.items[i].url);
+        free(list.items[i].fs_path);
+    }
+    free(list.items);
+    free(strings);
+    free(buckets);
+    free(copy_buf);
+    return 0;
+}
@@ -12,6 +12,8 @@ HTDOCS="$2"
 PORT="$3"
 THREADS="$4"
 NUM_RUNS="${5:-5}"
+# Дополнительные опции сервера (например, SERVER_ARGS="-p bulk")
+SERVER_ARGS="${SERVER_ARGS-}"
 
 RESOURCES_DIR="$HTDOCS/resources"
 TEMP_DIR="$RESOURCES_DIR/temp_filesize_test"
@@ -70,8 +72,8 @@ wait_for_server() {
     exit 1
 }
 
-echo "Запуск сервера: $SERVER $HTDOCS $PORT $THREADS"
-"$SERVER" "$HTDOCS" "$PORT" "$THREADS" &
+echo "Запуск сервера: $SERVER $SERVER_ARGS $HTDOCS $PORT $THREADS"
+"$SERVER" $SERVER_ARGS "$HTDOCS" "$PORT" "$THREADS" &
 SERVER_PID=$!
 
 wait_for_server
@@ -82,9 +84,7 @@ for file in "${FILES[@]}"; do
     name="${file%%:*}"
     size_kb="${file##*:}"
     filepath="$TEMP_DIR/file_$name.bin"
-    url="http://localhost:$PORT/\
-    resources/temp_filesize_test/\
-    file_$name.bin"
+    url="http://localhost:$PORT/resources/temp_filesize_test/file_$name.bin"
     size_bytes=$((size_kb * 1024))
 
     dd if=/dev/urandom of="$filepath" bs=1024 count="$size_kb" status=none